@@ -0,0 +1,19 @@
+#!/bin/sh
+# builds optimized benchmark binaries, runs them and appends the results, tagged with the current commit,
+# to bench_results.jsonl
+#   ./bench.sh [search|units] [exactonator flags, e.g. -j 4]
+set -e
+suite=all
+if [ "$1" = search ] || [ "$1" = units ]; then
+    suite=$1
+    shift
+fi
+commit=$(git rev-parse --short HEAD 2>/dev/null || echo unknown)
+if [ "$suite" != units ]; then
+    ${CXX:-clang++} -o exactonator-bench src/exactonator.cc -std=c++20 -lmpfr -O2 -DNDEBUG -pthread
+    ./exactonator-bench --bench "$@" | sed "s/^{/{\"commit\": \"$commit\", \"suite\": \"search\", /" | tee -a bench_results.jsonl
+fi
+if [ "$suite" != search ]; then
+    ${CXX:-clang++} -o exactonator-bench-units src/bench_units.cc -std=c++20 -O2 -DNDEBUG
+    ./exactonator-bench-units | sed "s/^{/{\"commit\": \"$commit\", \"suite\": \"units\", /" | tee -a bench_results.jsonl
+fi
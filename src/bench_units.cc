@@ -0,0 +1,63 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include <cstdio>
+#include <cinttypes>
+
+#include "phys/units/io.hpp"
+#include "phys/units/quantity.hpp"
+#include "phys/units/other_units.hpp"
+
+/* microbenchmarks for the units layer on its own, no mpfr involved
+ * prints one json object per case, like exactonator --bench
+ */
+
+using phys::units::quantity;
+
+/* keeps results alive so the compiler can't drop the work */
+volatile double sink = 0;
+
+template<typename F>
+void bench(const char *name, std::uint64_t iterations, F f) {
+    f(); /* warm up */
+    const auto start = std::chrono::steady_clock::now();
+    for (std::uint64_t i = 0; i < iterations; i++) {
+        f();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const double ns = seconds * 1e9 / static_cast<double>(iterations);
+    std::printf("{\"case\": \"%s\", \"iterations\": %" PRIu64 ", \"seconds\": %.6f, \"ns_per_op\": %.2f}\n", name, iterations, seconds, ns);
+    std::fprintf(stderr, "%-24s %12.2f ns/op\n", name, ns);
+}
+
+int main() {
+    using namespace phys::units;
+
+    const quantity speed = meter() / second();
+    const quantity accel = meter() / (second() * second());
+    const quantity length = meter();
+    const quantity other_speed = accel * second();
+    const quantity scalar = quantity(dimensionless_d, 2.0);
+    const dimensions speed_d = speed.dimension(), time_d = second().dimension();
+
+    bench("dimensions_product", 2000000, [&] { sink = sink + !product(speed_d, time_d).is_all_zero(); });
+    bench("dimensions_quotient", 2000000, [&] { sink = sink + !quotient(speed_d, time_d).is_all_zero(); });
+    bench("dimensions_power", 2000000, [&] { sink = sink + !power(speed_d, 3).is_all_zero(); });
+    bench("quantity_multiply", 2000000, [&] { sink = sink + (speed * length).value(); });
+    bench("quantity_divide", 2000000, [&] { sink = sink + (speed / length).value(); });
+    bench("quantity_compare", 2000000, [&] { sink = sink + (speed < speed * 2.0); });
+    bench("same_dimension_equal", 5000000, [&] { sink = sink + speed.same_dimension(other_speed); });
+    bench("same_dimension_differ", 5000000, [&] { sink = sink + speed.same_dimension(accel); });
+    bench("same_dimension_scalar", 5000000, [&] { sink = sink + scalar.same_dimension(quantity()); });
+    bench("nth_power", 2000000, [&] { sink = sink + nth_power(speed, 3).value(); });
+    bench("parse_scalar", 200000, [&] { sink = sink + to_unit("2.71828", dimensionless()).value(); });
+    bench("parse_speed", 200000, [&] { sink = sink + to_unit("299792458 m/s", dimensionless()).value(); });
+    bench("parse_compound", 200000, [&] { sink = sink + to_unit("6.674e-11 m3/(kg s2)", dimensionless()).value(); });
+    bench("eng_unit_scalar", 200000, [&] { sink = sink + to_eng_unit(scalar).size(); });
+    bench("eng_unit_speed", 200000, [&] { sink = sink + to_eng_unit(speed).size(); });
+    bench("eng_string_accel", 200000, [&] { sink = sink + to_eng_string(accel * 9.80665).size(); });
+
+    return 0;
+}
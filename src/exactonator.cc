@@ -5,14 +5,38 @@
 #include <memory>
 #include <functional>
 #include <unordered_map>
+#include <unordered_set>
+#include <map>
 #include <utility>
 #include <optional>
 #include <vector>
 #include <stdexcept>
 #include <filesystem>
+#include <iterator>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <queue>
+#include <chrono>
+#include <limits>
+#include <numeric>
+#include <array>
+#include <barrier>
+#include <random>
+#include <charconv>
+
+#include <cstring>
 
 #include <cinttypes>
 
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
 #include "mpreal/mpreal.h"
 
 #include "const_e.h"
@@ -49,10 +73,25 @@ enum struct err_t : std::uint32_t {
     dimension_add, dimension_dim_exp, dimension_nonint_exp_dim_base, dimension_nonint_exp_neg_base,
     create_save_dir,
     redef_constant, redef_default_constant,
+    const_verify,
     hashed_none_expr,
     bad_thread_count,
+    missing_option_arg,
+    bad_limit,
+    open_batch_file,
+    socket,
+    bad_shard, bad_partial,
+    bad_engine,
+    bad_function,
+    write_stats,
+    collect_file,
 };
 
+/* how many bits of precision are used for a number of digits */
+mpfr_prec_t digits_to_prec(std::int32_t digits) {
+    return static_cast<mpfr_prec_t>(std::pow(10, std::log2(digits + 1)));
+}
+
 std::string unit_to_str(const quantity &q) {
     std::string res = phys::units::to_eng_unit(q);
     if (res.empty()) {
@@ -62,6 +101,59 @@ std::string unit_to_str(const quantity &q) {
 }
 
 
+/* hot path counters, kept per thread and added up as workers finish
+ * a thread-local increment each, or nothing at all when built with -DEXACTONATOR_NO_STATS
+ */
+enum struct stat_t : std::uint32_t {
+    nodes, loads, load_hits,
+    mpfr_add, mpfr_sub, mpfr_mul, mpfr_div, mpfr_pow, mpfr_cost,
+    dimension_rejects, pruned, rewrites, equivalent, mpfr_func, func_hits,
+    count
+};
+
+static constexpr const char *STAT_NAMES[] = {
+    "nodes", "loads", "load_hits",
+    "mpfr_add", "mpfr_sub", "mpfr_mul", "mpfr_div", "mpfr_pow", "mpfr_cost",
+    "dimension_rejects", "pruned", "rewrites", "equivalent", "mpfr_func", "func_hits",
+};
+
+thread_local std::array<std::uint64_t, static_cast<std::size_t>(stat_t::count)> stats_local{};
+std::array<std::atomic_uint64_t, static_cast<std::size_t>(stat_t::count)> stats{};
+
+inline void count_stat([[maybe_unused]] stat_t stat) {
+#ifndef EXACTONATOR_NO_STATS
+    stats_local[static_cast<std::size_t>(stat)]++;
+#endif
+}
+
+void flush_stats() {
+    for (std::size_t i = 0; i < stats_local.size(); i++) {
+        stats[i] += stats_local[i];
+        stats_local[i] = 0;
+    }
+}
+
+/* wall time spent in each phase of a run, only ever touched from the main thread */
+enum struct phase_t : std::uint32_t {
+    setup, enumeration, merge, output,
+    count
+};
+
+static constexpr const char *PHASE_NAMES[] = {"setup", "enumeration", "merge", "output"};
+
+std::array<double, static_cast<std::size_t>(phase_t::count)> phase_seconds{};
+
+struct phase_timer_t {
+    phase_t phase;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    explicit phase_timer_t(phase_t phase) : phase(phase) {}
+
+    ~phase_timer_t() {
+        phase_seconds[static_cast<std::size_t>(phase)] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
 struct dimreal_t {
     mpreal value;
     quantity unit;
@@ -70,6 +162,7 @@ struct dimreal_t {
         if (!unit.same_dimension(other.unit)) {
             ERR_EXIT(err_t::dimension_add, "attempted to add with different dimension: %s + %s", to_str().c_str(), other.to_str().c_str())
         }
+        count_stat(stat_t::mpfr_add);
         return dimreal_t{value + other.value, unit};
     }
 
@@ -77,6 +170,7 @@ struct dimreal_t {
         if (!unit.same_dimension(other.unit)) {
             ERR_EXIT(err_t::dimension_add, "attempted to subtract with different dimension: %s - %s", to_str().c_str(), other.to_str().c_str())
         }
+        count_stat(stat_t::mpfr_sub);
         return dimreal_t{value - other.value, unit};
     }
 
@@ -85,10 +179,12 @@ struct dimreal_t {
     }
 
     dimreal_t operator*(const dimreal_t &other) const {
+        count_stat(stat_t::mpfr_mul);
         return dimreal_t{value * other.value, unit * other.unit};
     }
 
     dimreal_t operator/(const dimreal_t &other) const {
+        count_stat(stat_t::mpfr_div);
         return dimreal_t{value / other.value, unit / other.unit};
     }
 
@@ -103,6 +199,7 @@ struct dimreal_t {
         if (!mpfr::isint(other.value) && !unit.same_dimension(quantity())) {
             ERR_EXIT(err_t::dimension_nonint_exp_dim_base, "attempted to exponentiate with non-integer exponent and non-dimensionless base: %s ^ %s", to_str().c_str(), other.to_str().c_str())
         }
+        count_stat(stat_t::mpfr_pow);
         if (unit.dimension() == phys::units::dimensionless_d) {
             if (value < 0 && !mpfr::isint(other.value)) {
                 ERR_EXIT(err_t::dimension_nonint_exp_neg_base, "attempted to exponentiate with a non-integer exponent and a negative base: %s ^ %s", to_str().c_str(), other.to_str().c_str())
@@ -121,10 +218,20 @@ struct dimreal_t {
     }
 
     static dimreal_t from_str(const std::string &text) {
-        auto a = dimreal_t{text, phys::units::to_unit(text, phys::units::dimensionless())};
+        return from_str(text, mpreal(text));
+    }
+
+    /* for when the numeric part was already parsed (or cached) elsewhere */
+    static dimreal_t from_str(const std::string &text, mpreal value) {
+        auto a = parse(text, std::move(value));
         std::cout << text << " : " << a.to_str(5) << '\n';
         return a;
     }
+
+    /* from_str without echoing what was read, throws phys::units::quantity_error on a unit it can't parse */
+    static dimreal_t parse(const std::string &text, mpreal value) {
+        return dimreal_t{std::move(value), phys::units::to_unit(text, phys::units::dimensionless())};
+    }
 };
 
 mpreal cost(const mpreal &a, const mpreal &b) {
@@ -149,20 +256,235 @@ std::string get_file_content(const std::string& filename) {
     return text;
 }
 
+/* checks a computed e against the const_e.h fixture over the digits both have,
+ * dropping the last one since it may round either way
+ */
+void verify_const_e(const mpreal &e) {
+    const std::size_t fixture_digits = sizeof(const_e_str) - 2; /* without the '.' and the terminator */
+    const int n = static_cast<int>(std::min<std::size_t>(std::max(digits_prec, 2), fixture_digits));
+    const std::string computed = e.toString(n);
+    if (computed.size() < static_cast<std::size_t>(n) || computed.compare(0, n, const_e_str, n) != 0) {
+        ERR_EXIT(err_t::const_verify, "computed e does not match the fixture in the first %i digits: %s", n - 1, computed.c_str())
+    }
+}
+
+/* e at the current default precision, memoized per precision */
+mpreal const_e() {
+    thread_local std::unordered_map<mpfr_prec_t, mpreal> memo;
+    const mpfr_prec_t prec = mpreal::get_default_prec();
+    auto pos = memo.find(prec);
+    if (pos != memo.end()) {
+        return pos->second;
+    }
+    mpreal e = mpfr::exp(mpreal(1, prec));
+    verify_const_e(e);
+    return memo.emplace(prec, std::move(e)).first->second;
+}
+
 struct cnst_t {
     dimreal_t value;
     std::string name;
     bool is_default = false;
 };
 
+/* binary cache of constant values, one file per precision in the save directory,
+ * so pi/euler/catalan and friends are computed once and then just read back in
+ * default constants are keyed by name, user constants by "%" + their text from constants.conf
+ */
+struct cnst_cache_t {
+    static constexpr const char magic[4] = {'E', 'X', 'C', 'C'};
+    static constexpr std::uint32_t version = 1;
+
+    mpfr_prec_t prec;
+    std::unordered_map<std::string, mpreal> values;
+    bool modified = false;
+
+    explicit cnst_cache_t(mpfr_prec_t prec) : prec(prec) {}
+
+    std::string filename() const {
+        return std::string(SAVE_AST_DIR) + "/constants-" + std::to_string(prec) + ".bin";
+    }
+
+    std::size_t limb_count() const {
+        return mpfr_custom_get_size(prec) / sizeof(mp_limb_t);
+    }
+
+    /* reads the whole file in one go; a missing, truncated, or mismatched file is just an empty cache */
+    void load() {
+        std::ifstream file(filename(), std::ios::binary);
+        if (!file) { return; }
+        const std::string buf{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+        std::size_t off = 0;
+        auto take = [&](void *dst, std::size_t n) -> bool {
+            if (off + n > buf.size()) { return false; }
+            std::memcpy(dst, buf.data() + off, n);
+            off += n;
+            return true;
+        };
+
+        char fmagic[4];
+        std::uint32_t fversion = 0, count = 0;
+        std::int64_t fprec = 0;
+        if (!take(fmagic, sizeof(fmagic)) || std::memcmp(fmagic, magic, sizeof(magic)) != 0) { return; }
+        if (!take(&fversion, sizeof(fversion)) || fversion != version) { return; }
+        if (!take(&fprec, sizeof(fprec)) || fprec != prec) { return; }
+        if (!take(&count, sizeof(count))) { return; }
+
+        std::vector<mp_limb_t> limbs(limb_count());
+        for (std::uint32_t i = 0; i < count; i++) {
+            std::uint32_t keylen = 0;
+            std::int32_t kind = 0;
+            std::int64_t exp = 0;
+            if (!take(&keylen, sizeof(keylen)) || off + keylen > buf.size()) { return; }
+            std::string key = buf.substr(off, keylen);
+            off += keylen;
+            if (!take(&kind, sizeof(kind)) || !take(&exp, sizeof(exp))) { return; }
+            if (!take(limbs.data(), limbs.size() * sizeof(mp_limb_t))) { return; }
+
+            /* view the stored limbs as an mpfr number, then copy it out exactly since precisions match */
+            mpfr_t view;
+            mpfr_custom_init_set(view, kind, static_cast<mpfr_exp_t>(exp), prec, limbs.data());
+            values.insert_or_assign(std::move(key), mpreal(view));
+        }
+    }
+
+    void store() const {
+        if (!modified) { return; }
+        std::ofstream file(filename(), std::ios::binary | std::ios::trunc);
+        const std::int64_t fprec = prec;
+        const auto count = static_cast<std::uint32_t>(values.size());
+        file.write(magic, sizeof(magic));
+        file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        file.write(reinterpret_cast<const char*>(&fprec), sizeof(fprec));
+        file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+
+        const std::vector<mp_limb_t> zeros(limb_count());
+        for (const auto &[key, value] : values) {
+            const auto keylen = static_cast<std::uint32_t>(key.size());
+            const std::int32_t kind = mpfr_custom_get_kind(value.mpfr_srcptr());
+            const std::int64_t exp = mpfr_regular_p(value.mpfr_srcptr()) ? mpfr_custom_get_exp(value.mpfr_srcptr()) : 0;
+            file.write(reinterpret_cast<const char*>(&keylen), sizeof(keylen));
+            file.write(key.data(), keylen);
+            file.write(reinterpret_cast<const char*>(&kind), sizeof(kind));
+            file.write(reinterpret_cast<const char*>(&exp), sizeof(exp));
+            const void *limbs = mpfr_regular_p(value.mpfr_srcptr()) ? mpfr_custom_get_significand(value.mpfr_srcptr()) : zeros.data();
+            file.write(static_cast<const char*>(limbs), static_cast<std::streamsize>(zeros.size() * sizeof(mp_limb_t)));
+        }
+    }
+
+    mpreal get(const std::string &key, const std::function<mpreal ()> &compute) {
+        auto pos = values.find(key);
+        if (pos != values.end()) {
+            return pos->second;
+        }
+        mpreal value = compute();
+        if (mpfr_get_prec(value.mpfr_srcptr()) != prec) {
+            value.set_prec(prec);
+        }
+        values.emplace(key, value);
+        modified = true;
+        return value;
+    }
+};
+
+struct default_cnst_t {
+    std::string name;
+    std::function<mpreal ()> compute;
+};
+
+/* computed lazily through the constant cache, only the ones named in constants.conf are ever needed */
+const std::vector<default_cnst_t> default_constants = {
+    {"pi", [] { return mpfr::const_pi(); }},
+    {"e", [] { return const_e(); }},
+    {"euler", [] { return mpfr::const_euler(); }},
+    {"ln2", [] { return mpfr::const_log2(); }},
+    {"catalan", [] { return mpfr::const_catalan(); }},
+    {"phi", [] { return ("1" + mpfr::sqrt("5")) / "2"; }},
+    {"fine-structure", [] { return mpreal("0.0072973525693"); }},
+};
+
 std::vector<cnst_t> constants;
 std::unique_ptr<dimreal_t> target;
 
+/* mpfr's default precision and rounding mode are per thread and mpreal reads them in every constructor,
+ * so any thread evaluating expressions has to be inside one of these first
+ * nests, restoring the outer settings on the way out; the outermost one frees the thread's mpfr caches
+ */
+struct prec_scope_t {
+    static thread_local std::uint32_t depth;
+
+    mpfr_prec_t outer_prec;
+    mpfr_rnd_t outer_rnd;
+
+    explicit prec_scope_t(mpfr_prec_t prec, mpfr_rnd_t rnd) : outer_prec(mpfr_get_default_prec()), outer_rnd(mpfr_get_default_rounding_mode()) {
+        mpfr_set_default_prec(prec);
+        mpfr_set_default_rounding_mode(rnd);
+        depth++;
+    }
+
+    prec_scope_t(const prec_scope_t&) = delete;
+    prec_scope_t &operator=(const prec_scope_t&) = delete;
+
+    ~prec_scope_t() {
+        mpfr_set_default_prec(outer_prec);
+        mpfr_set_default_rounding_mode(outer_rnd);
+        if (--depth == 0) {
+            mpfr_free_cache2(MPFR_FREE_LOCAL_CACHE);
+        }
+    }
+};
+
+thread_local std::uint32_t prec_scope_t::depth = 0;
+
+/* everything one thread needs to evaluate at its own precision: the constants and targets rounded to it,
+ * plus scratch registers so the hot path doesn't allocate
+ * e.g. a coarse prefilter context and a full precision one can run side by side on different threads
+ */
+struct eval_ctx_t {
+    prec_scope_t scope; /* first, so the members below are built at this precision */
+    mpfr_prec_t prec;
+    mpfr_rnd_t rnd;
+    std::vector<cnst_t> constants;
+    std::vector<dimreal_t> targets; /* all of one dimension, sorted by value */
+    mpreal diff;
+
+    explicit eval_ctx_t(mpfr_prec_t prec, mpfr_rnd_t rnd, const std::vector<cnst_t> &constants, const std::vector<dimreal_t> &targets)
+        : scope(prec, rnd), prec(prec), rnd(rnd), constants(constants), targets(targets) {
+        for (cnst_t &constant : this->constants) {
+            round(constant.value.value);
+        }
+        for (dimreal_t &target : this->targets) {
+            round(target.value);
+        }
+    }
+
+    /* what every result has to come out as, literals are given units to match it */
+    const quantity &unit() const {
+        return targets.front().unit;
+    }
+
+    void round(mpreal &a) const {
+        if (a.get_prec() != prec) {
+            a.set_prec(prec, rnd);
+        }
+    }
+
+    /* same as cost() but into the scratch register */
+    const mpreal &cost(const mpreal &a, const mpreal &b) {
+        count_stat(stat_t::mpfr_cost);
+        mpfr_sub(diff.mpfr_ptr(), a.mpfr_srcptr(), b.mpfr_srcptr(), rnd);
+        mpfr_abs(diff.mpfr_ptr(), diff.mpfr_srcptr(), rnd);
+        return diff;
+    }
+};
+
 enum struct etype_t : std::uint32_t {
     litexpr, cnstexpr,
     addexpr, subexpr,
     mulexpr, divexpr,
     powexpr,
+    unexpr,
     none
 };
 
@@ -171,21 +493,28 @@ struct expr_t { /* NOLINT */
     std::vector<std::shared_ptr<expr_t>> parents;
     etype_t type = etype_t::none;
     std::atomic_bool dirty = true;
-    dimreal_t cache;
+    std::optional<dimreal_t> cache; /* re-emplaced rather than assigned, quantity refuses assignment across dimensions */
 
-    explicit expr_t() = default;
-    explicit expr_t(decltype(exprs) exprs, decltype(parents) parents) : exprs(std::move(exprs)), parents(std::move(parents)) {}
+    explicit expr_t() {
+        count_stat(stat_t::nodes);
+    }
+    explicit expr_t(decltype(exprs) exprs, decltype(parents) parents) : exprs(std::move(exprs)), parents(std::move(parents)) {
+        count_stat(stat_t::nodes);
+    }
     virtual ~expr_t() = default;
 
+    /* the same tree, node for node, without evaluating anything */
     bool operator==(const expr_t &other) const {
-        bool res = true;
+        if (type != other.type || exprs.size() != other.exprs.size() || !same_node(other)) { return false; }
         for (std::uint32_t i = 0; i < exprs.size(); i++) {
-            res = res && (*exprs[i] == *other.exprs[i]);
-        }
-        for (std::uint32_t i = 0; i < parents.size(); i++) {
-            res = res && (*parents[i] == *other.parents[i]);
+            if (exprs[i] != other.exprs[i] && !(*exprs[i] == *other.exprs[i])) { return false; }
         }
-        return res;
+        return true;
+    }
+
+    /* what the type doesn't say about a node, its value or name, other is already known to have the same type */
+    virtual bool same_node(const expr_t &) const {
+        return true;
     }
 
     std::uint32_t size() {
@@ -203,21 +532,188 @@ struct expr_t { /* NOLINT */
         }
     }
 
-    dimreal_t load() {
-        if (dirty) {
-            cache = rload();
+    const dimreal_t &load() {
+        count_stat(stat_t::loads);
+        if (!dirty) {
+            count_stat(stat_t::load_hits);
+        } else {
+            cache.emplace(rload());
             dirty = false;
         }
-        return cache;
+        return *cache;
     }
     
     virtual dimreal_t rload() = 0;
-    virtual std::string disp() = 0;
+
+    /* appends the expression to out, see binexpr_t::render for where parentheses go */
+    virtual void render(std::string &out) = 0;
+
+    /* how tightly the expression binds when it's an operand, atoms bind tightest */
+    virtual std::int32_t precedence() const {
+        return 4;
+    }
+
+    std::string disp() {
+        std::string out;
+        out.reserve(64);
+        render(out);
+        return out;
+    }
 };
 
 using sptrexpr_t = std::shared_ptr<expr_t>;
 
-std::vector<std::pair<mpreal, sptrexpr_t>> all;
+std::size_t result_count = 30;
+
+/* --complexity: how many digits of error one unit of description length is worth, so a longer expression has to be
+ * that much closer to make up for it, 0 ranks by error alone
+ */
+double complexity_weight = 0;
+
+/* log10 |x|, without going through a double that could under or overflow at high precision */
+double log10_of(const mpreal &x) {
+    long exp = 0;
+    const double mantissa = mpfr_get_d_2exp(&exp, x.mpfr_srcptr(), MPFR_RNDN);
+    return std::log10(std::fabs(mantissa)) + static_cast<double>(exp) * std::log10(2.0);
+}
+
+/* the error in digits plus complexity_weight digits per unit of length, lower is better
+ * errors below the precision being searched at, relative to the value, all count the same, so an exact hit still pays
+ * for its length
+ */
+double score(const mpreal &err, const mpreal &value, double length) {
+    return std::max(log10_of(err), log10_of(value) - digits_prec) + complexity_weight * length;
+}
+
+struct result_t {
+    mpreal err;
+    sptrexpr_t expr;
+    std::uint32_t size; /* of expr */
+    std::uint32_t seed; /* top level seed it was found under */
+    std::string key; /* the same for results that are equal by the e-graph rules, see equivalence */
+    double length = 0, score = 0; /* only set with --complexity, length is description_length of expr as it was found */
+};
+
+/* by score when there's a complexity weight, then by error, size and seed */
+bool ranks_before(const result_t &a, const result_t &b) {
+    if (complexity_weight > 0 && a.score != b.score) { return a.score < b.score; }
+    if (a.err != b.err) { return a.err < b.err; }
+    return a.size < b.size || (a.size == b.size && a.seed < b.seed);
+}
+
+/* whether two results are the same value that was rounded differently on the way: the same error, or values within a
+ * few ulps of each other at the working precision, as when 3 * pi / 4 is also reached as pi / (2 / 3) ^ 2 / 3
+ */
+bool same_value(const result_t &a, const result_t &b) {
+    if (a.err == b.err) { return true; }
+    const mpreal &x = a.expr->load().value, &y = b.expr->load().value;
+    return mpfr::abs(x - y) <= mpfr::ldexp(mpfr::abs(x), 4 - static_cast<mp_exp_t>(mpreal::get_default_prec()));
+}
+
+void simplify(sptrexpr_t &a);
+
+/* what the e-graph rules make of an expression: the smallest expression equal to it, and a key that's the same for
+ * every expression they find equal to it (its rendering, without the e-graph)
+ */
+struct equivalence_t {
+    std::string key;
+    sptrexpr_t smallest;
+};
+
+bool use_egraph = true;
+bool prune_equivalent = false;
+equivalence_t equivalence(const sptrexpr_t &a);
+bool encodable(const sptrexpr_t &a, const quantity &unit);
+double description_length(const sptrexpr_t &a);
+
+/* the best results for one target, sorted by error, or by score with --complexity
+ * results with the same value (see same_value), or the same equivalence key, are taken to be the same result, and only
+ * the best ranked is kept, so merging buckets in any order gives what one pass in seed order would
+ */
+struct topk_t {
+    std::size_t k;
+    std::vector<result_t> items;
+
+    explicit topk_t(std::size_t k = result_count) : k(k) {}
+
+    bool full() const {
+        return items.size() >= k;
+    }
+
+    const mpreal &worst() const {
+        return items.back().err;
+    }
+
+    /* whether nothing this far from the target, with a value this size and at least this long, could be kept */
+    bool out_of_reach(const mpreal &err, const mpreal &value, double length) const {
+        if (!full()) { return false; }
+        if (complexity_weight > 0) {
+            return score(err, value, length) > items.back().score;
+        }
+        return err > worst();
+    }
+
+    /* a result is simplified and given its key before it's kept, and swapped for the smallest expression equal to it
+     * when that one can still be encoded
+     * its length is taken before any of that, so it's never less than the size it was enumerated at and the search can
+     * prune on that, a result read back from a file passes the length it had
+     */
+    bool offer(const mpreal &err, sptrexpr_t a, std::uint32_t seed, std::uint32_t size = 0, double length = 0) {
+        if (complexity_weight > 0 && length == 0) {
+            length = description_length(a);
+        }
+        if (out_of_reach(err, a->load().value, length)) { return false; }
+        simplify(a);
+        equivalence_t eq = equivalence(a);
+        if (eq.smallest->size() < a->size() && encodable(eq.smallest, a->load().unit)) {
+            a = std::move(eq.smallest);
+            size = 0;
+        }
+        if (size == 0) {
+            size = a->size();
+        }
+        result_t item{err, std::move(a), size, seed, std::move(eq.key)};
+        if (complexity_weight > 0) {
+            item.length = length;
+            item.score = score(err, item.expr->load().value, length);
+        }
+        return insert(std::move(item));
+    }
+
+    bool insert(result_t item) {
+        if (full() && !ranks_before(item, items.back())) { return false; }
+        /* one equal to a result already kept is the same result reached another way, so only the better of the two
+         * stays
+         */
+        for (auto it = items.begin(); it != items.end(); ++it) {
+            if (it->key == item.key) {
+                count_stat(stat_t::equivalent);
+                if (!ranks_before(item, *it)) { return false; }
+                items.erase(it);
+                break;
+            }
+        }
+        /* of the same value the smallest is kept, its error differing from the others' only by rounding */
+        for (auto it = items.begin(); it != items.end(); ++it) {
+            if (same_value(*it, item)) {
+                if (item.size > it->size || (item.size == it->size && !ranks_before(item, *it))) { return false; }
+                items.erase(it);
+                break;
+            }
+        }
+        items.insert(std::lower_bound(items.begin(), items.end(), item, ranks_before), std::move(item));
+        if (items.size() > k) {
+            items.pop_back();
+        }
+        return true;
+    }
+
+    void merge(const topk_t &other) {
+        for (const result_t &item : other.items) {
+            insert(item);
+        }
+    }
+};
 
 struct funcexpr_t : virtual expr_t {
     std::string name = "_funcexpr";
@@ -229,29 +725,137 @@ struct funcexpr_t : virtual expr_t {
         return f(exprs);
     }
 
-    std::string disp() override {
-        std::string arglist;
+    bool same_node(const expr_t &other) const override {
+        const auto *func = dynamic_cast<const funcexpr_t*>(&other);
+        return func && name == func->name;
+    }
+
+    void render(std::string &out) override {
+        out += name;
+        out += '(';
         for (std::uint32_t i = 0; i < exprs.size(); i++) {
-            arglist += exprs[i]->disp() + (i == exprs.size() - 1 ? "" : ", ");
+            if (i != 0) {
+                out += ", ";
+            }
+            exprs[i]->render(out);
+        }
+        out += ')';
+    }
+};
+
+/* the unary functions recurse can apply, to dimensionless values only */
+enum struct func_t : std::uint8_t {
+    sqrt, exp, ln, sin, cos, tan, gamma,
+    count
+};
+
+static constexpr const char *FUNC_NAMES[] = {
+    "sqrt", "exp", "ln", "sin", "cos", "tan", "gamma",
+};
+
+std::vector<func_t> functions; /* --functions, none by default */
+
+bool in_domain(func_t f, const mpreal &x) {
+    switch (f) {
+        case func_t::sqrt: return x >= 0;
+        case func_t::ln: return x > 0;
+        case func_t::gamma: return x > 0 || !mpfr::isint(x);
+        default: return true;
+    }
+}
+
+mpreal apply_func(func_t f, const mpreal &x) {
+    count_stat(stat_t::mpfr_func);
+    switch (f) {
+        case func_t::sqrt: return mpfr::sqrt(x);
+        case func_t::exp: return mpfr::exp(x);
+        case func_t::ln: return mpfr::log(x);
+        case func_t::sin: return mpfr::sin(x);
+        case func_t::cos: return mpfr::cos(x);
+        case func_t::tan: return mpfr::tan(x);
+        default: return mpfr::gamma(x);
+    }
+}
+
+/* every function of every constant and integer literal, computed once per precision, since a transcendental function
+ * at thousands of bits costs far more than all the arithmetic around it
+ * filled in before the workers start and only read while they run
+ */
+struct func_table_t {
+    struct entry_t {
+        mpreal x;
+        std::array<std::optional<mpreal>, static_cast<std::size_t>(func_t::count)> values;
+    };
+
+    std::string key; /* precision, constants and integers the table was built for */
+    std::vector<entry_t> entries; /* sorted by x */
+
+    void prepare(const std::vector<cnst_t> &list, std::int32_t max_int) {
+        std::string wanted = std::to_string(mpreal::get_default_prec()) + ";" + std::to_string(max_int);
+        for (const cnst_t &constant : list) {
+            wanted += ";" + constant.name;
         }
-        return name + "(" + arglist + ")";
+        if (functions.empty() || wanted == key) { return; }
+        key = std::move(wanted);
+        entries.clear();
+        for (const cnst_t &constant : list) {
+            if (constant.value.unit.same_dimension(quantity())) {
+                entries.push_back(entry_t{constant.value.value, {}});
+            }
+        }
+        for (long i = 0; i <= max_int; i++) {
+            entries.push_back(entry_t{mpreal(i), {}});
+        }
+        std::sort(entries.begin(), entries.end(), [](const entry_t &a, const entry_t &b) { return a.x < b.x; });
+        entries.erase(std::unique(entries.begin(), entries.end(), [](const entry_t &a, const entry_t &b) { return a.x == b.x; }), entries.end());
+        for (entry_t &entry : entries) {
+            for (func_t f : functions) {
+                if (in_domain(f, entry.x)) {
+                    entry.values[static_cast<std::size_t>(f)].emplace(apply_func(f, entry.x));
+                }
+            }
+        }
+    }
+
+    const mpreal *find(func_t f, const mpreal &x) const {
+        auto it = std::lower_bound(entries.begin(), entries.end(), x, [](const entry_t &entry, const mpreal &v) { return entry.x < v; });
+        if (it == entries.end() || it->x != x || !it->values[static_cast<std::size_t>(f)]) { return nullptr; }
+        return &*it->values[static_cast<std::size_t>(f)];
     }
 };
 
+func_table_t func_table;
+
 struct unexpr_t : virtual expr_t {
     std::string name = "_unexpr";
+    func_t func;
 
-    explicit unexpr_t(sptrexpr_t a, std::string name) : name(std::move(name)) {
+    explicit unexpr_t(sptrexpr_t a, func_t func) : name(FUNC_NAMES[static_cast<std::size_t>(func)]), func(func) {
+        type = etype_t::unexpr;
         exprs.emplace_back(std::move(a));
     }
 
-    
+    /* functions of constants and integers come out of the table, anything else is computed */
     dimreal_t rload() override {
-        return exprs[0]->load();
+        const dimreal_t &arg = exprs[0]->load();
+        if (exprs[0]->type == etype_t::cnstexpr || exprs[0]->type == etype_t::litexpr) {
+            if (const mpreal *value = func_table.find(func, arg.value)) {
+                count_stat(stat_t::func_hits);
+                return dimreal_t{*value};
+            }
+        }
+        return dimreal_t{apply_func(func, arg.value)};
+    }
+
+    bool same_node(const expr_t &other) const override {
+        return func == dynamic_cast<const unexpr_t&>(other).func;
     }
 
-    std::string disp() override {
-        return "(" + exprs[0]->disp() + " " + name + " " + exprs[1]->disp() + ")";
+    void render(std::string &out) override {
+        out += name;
+        out += '(';
+        exprs[0]->render(out);
+        out += ')';
     }
 };
 
@@ -265,8 +869,31 @@ struct litexpr_t : virtual expr_t {
         return value;
     }
 
-    std::string disp() override {
-        return value.to_str(digits_prec);
+    bool same_node(const expr_t &other) const override {
+        const auto &lit = dynamic_cast<const litexpr_t&>(other);
+        return value.value == lit.value.value && value.unit.same_dimension(lit.value.unit);
+    }
+
+    /* integers are written straight out instead of going through mpfr's formatting at full precision */
+    void render(std::string &out) override {
+        if (mpfr::isint(value.value) && mpfr_fits_slong_p(value.value.mpfr_srcptr(), MPFR_RNDN)) {
+            char buf[24];
+            const auto end = std::to_chars(buf, buf + sizeof(buf), mpfr_get_si(value.value.mpfr_srcptr(), MPFR_RNDN)).ptr;
+            out.append(buf, end);
+        } else {
+            out += value.value.toString(digits_prec);
+        }
+        if (!value.unit.same_dimension(quantity())) {
+            out += unit_to_str(value.unit);
+        }
+    }
+
+    /* "2 m/s" reads as a product, so it's parenthesized like one, and a negative number like a difference */
+    std::int32_t precedence() const override {
+        if (value.value < 0) {
+            return 1;
+        }
+        return value.unit.same_dimension(quantity()) ? 4 : 2;
     }
 };
 
@@ -282,8 +909,12 @@ struct cnstexpr_t : virtual expr_t {
         return value;
     }
 
-    std::string disp() override {
-        return name;
+    bool same_node(const expr_t &other) const override {
+        return name == dynamic_cast<const cnstexpr_t&>(other).name;
+    }
+
+    void render(std::string &out) override {
+        out += name;
     }
 };
 
@@ -294,6 +925,31 @@ struct binexpr_t : virtual expr_t {
         exprs.emplace_back(std::move(a));
         exprs.emplace_back(std::move(b));
     }
+
+    /* an operand only gets parentheses when it binds looser than this operator, or as tightly but on the side where
+     * leaving them out would change the value: the right of - and /, and the left of ^ since ^ groups to the right
+     */
+    void render(std::string &out) override {
+        const std::int32_t prec = precedence();
+        const bool right_grouping = type == etype_t::powexpr;
+        const bool left_parens = exprs[0]->precedence() < prec || (exprs[0]->precedence() == prec && right_grouping);
+        const bool right_parens = exprs[1]->precedence() < prec || (exprs[1]->precedence() == prec && (type == etype_t::subexpr || type == etype_t::divexpr));
+        render_operand(out, exprs[0], left_parens);
+        out += ' ';
+        out += name;
+        out += ' ';
+        render_operand(out, exprs[1], right_parens);
+    }
+
+    static void render_operand(std::string &out, const sptrexpr_t &a, bool parens) {
+        if (parens) {
+            out += '(';
+        }
+        a->render(out);
+        if (parens) {
+            out += ')';
+        }
+    }
 };
 
 struct addexpr_t : public binexpr_t {
@@ -304,8 +960,8 @@ struct addexpr_t : public binexpr_t {
         return exprs[0]->load() + exprs[1]->load();
     }
 
-    std::string disp() override {
-        return "(" + exprs[0]->disp() + " " + name + " " + exprs[1]->disp() + ")";
+    std::int32_t precedence() const override {
+        return 1;
     }
 };
 
@@ -317,8 +973,8 @@ struct subexpr_t : public binexpr_t {
         return exprs[0]->load() - exprs[1]->load();
     }
 
-    std::string disp() override {
-        return "(" + exprs[0]->disp() + " " + name + " " + exprs[1]->disp() + ")";
+    std::int32_t precedence() const override {
+        return 1;
     }
 };
 
@@ -330,8 +986,8 @@ struct mulexpr_t : public binexpr_t {
         return exprs[0]->load() * exprs[1]->load();
     }
 
-    std::string disp() override {
-        return "(" + exprs[0]->disp() + " " + name + " " + exprs[1]->disp() + ")";
+    std::int32_t precedence() const override {
+        return 2;
     }
 };
 
@@ -343,8 +999,8 @@ struct divexpr_t : public binexpr_t {
         return exprs[0]->load() / exprs[1]->load();
     }
 
-    std::string disp() override {
-        return "(" + exprs[0]->disp() + " " + name + " " + exprs[1]->disp() + ")";
+    std::int32_t precedence() const override {
+        return 2;
     }
 };
 
@@ -356,254 +1012,2722 @@ struct powexpr_t : public binexpr_t {
         return exprs[0]->load().pow(exprs[1]->load());
     }
 
-    std::string disp() override {
-        return "(" + exprs[0]->disp() + " " + name + " " + exprs[1]->disp() + ")";
+    std::int32_t precedence() const override {
+        return 3;
     }
 };
 
-std::uint32_t simplify_passes = 0;
+/* binary forms for the files in save/, partial results and server tables, so nothing has to be reparsed
+ * everything is written in host byte order, these files aren't meant to move between machines
+ */
+template<typename T>
+void write_pod(std::ostream &out, const T &value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template<typename T>
+bool read_pod(std::istream &in, T &value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
 
-void simplify(sptrexpr_t &a) {
-    if (a->size() <= 1) { return; } /* it's just one thing, can't be simplified */
+void write_str(std::ostream &out, const std::string &text) {
+    write_pod(out, static_cast<std::uint32_t>(text.size()));
+    out.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
 
-    if (a->type == etype_t::addexpr) {
+bool read_str(std::istream &in, std::string &text) {
+    std::uint32_t len = 0;
+    if (!read_pod(in, len)) { return false; }
+    text.resize(len);
+    return static_cast<bool>(in.read(text.data(), len));
+}
 
-        /* 0 + expr */
-        if (a->exprs[0]->load() == dimreal_t{0}) {
-            a = std::move(a->exprs[1]);
-            goto redo;
-        }
+/* an mpreal at exactly prec bits as its kind, exponent and limbs */
+void write_raw(std::ostream &out, const mpreal &value, mpfr_prec_t prec) {
+    mpreal rounded = value;
+    if (rounded.get_prec() != prec) {
+        rounded.set_prec(prec);
+    }
+    const std::size_t limb_count = mpfr_custom_get_size(prec) / sizeof(mp_limb_t);
+    const bool regular = mpfr_regular_p(rounded.mpfr_srcptr());
+    write_pod(out, static_cast<std::int32_t>(mpfr_custom_get_kind(rounded.mpfr_srcptr())));
+    write_pod(out, static_cast<std::int64_t>(regular ? mpfr_custom_get_exp(rounded.mpfr_srcptr()) : 0));
+    if (regular) {
+        out.write(static_cast<const char*>(mpfr_custom_get_significand(rounded.mpfr_srcptr())), static_cast<std::streamsize>(limb_count * sizeof(mp_limb_t)));
+    } else {
+        const std::vector<mp_limb_t> zeros(limb_count);
+        out.write(reinterpret_cast<const char*>(zeros.data()), static_cast<std::streamsize>(limb_count * sizeof(mp_limb_t)));
+    }
+}
 
-        /* expr + 0 */
-        if (a->exprs[1]->load() == dimreal_t{0}) {
-            a = std::move(a->exprs[0]);
-            goto redo;
-        }
+bool read_raw(std::istream &in, mpfr_prec_t prec, mpreal &value) {
+    std::int32_t kind = 0;
+    std::int64_t exp = 0;
+    std::vector<mp_limb_t> limbs(mpfr_custom_get_size(prec) / sizeof(mp_limb_t));
+    if (!read_pod(in, kind) || !read_pod(in, exp)) { return false; }
+    if (!in.read(reinterpret_cast<char*>(limbs.data()), static_cast<std::streamsize>(limbs.size() * sizeof(mp_limb_t)))) { return false; }
+    mpfr_t view;
+    mpfr_custom_init_set(view, kind, static_cast<mpfr_exp_t>(exp), prec, limbs.data());
+    value = mpreal(view);
+    return true;
+}
 
-    } else if (a->type == etype_t::subexpr) {
+/* units go by their si base symbols, only the dimension has to survive */
+void write_unit(std::ostream &out, const quantity &unit) {
+    write_str(out, phys::units::to_base_unit_symbols(unit));
+}
 
-        /* expr - 0 */
-        if (a->exprs[1]->load() == dimreal_t{0}) {
-            a = std::move(a->exprs[0]);
-            goto redo;
-        }
+/* a quantity can't be assigned one of another dimension, so this gives a fresh one */
+std::optional<quantity> read_unit(std::istream &in) {
+    std::string symbols;
+    if (!read_str(in, symbols)) { return std::nullopt; }
+    return phys::units::to_unit("1 " + symbols, phys::units::dimensionless());
+}
 
-    } else if (a->type == etype_t::mulexpr) {
+void write_cnst_list(std::ostream &out, const std::vector<cnst_t> &list, mpfr_prec_t prec) {
+    write_pod(out, static_cast<std::uint32_t>(list.size()));
+    for (const cnst_t &constant : list) {
+        write_str(out, constant.name);
+        write_pod(out, static_cast<std::uint8_t>(constant.is_default));
+        write_raw(out, constant.value.value, prec);
+        write_unit(out, constant.value.unit);
+    }
+}
 
-        /* 1 * expr */
-        if (a->exprs[0]->load() == dimreal_t{1}) {
-            a = std::move(a->exprs[1]);
-            goto redo;
-        }
+bool read_cnst_list(std::istream &in, std::vector<cnst_t> &list, mpfr_prec_t prec) {
+    std::uint32_t count = 0;
+    if (!read_pod(in, count)) { return false; }
+    list.clear();
+    for (std::uint32_t i = 0; i < count; i++) {
+        std::string name;
+        std::uint8_t is_default = 0;
+        mpreal value;
+        if (!read_str(in, name) || !read_pod(in, is_default) || !read_raw(in, prec, value)) { return false; }
+        std::optional<quantity> unit = read_unit(in);
+        if (!unit) { return false; }
+        list.push_back(cnst_t{dimreal_t{value, *unit}, name, is_default != 0});
+    }
+    return true;
+}
 
-        /* expr * 1 */
-        if (a->exprs[1]->load() == dimreal_t{1}) {
-            a = std::move(a->exprs[0]);
-            goto redo;
-        }
+void put_varint(std::string &out, std::uint64_t value) {
+    for (; value >= 0x80; value >>= 7) {
+        out.push_back(static_cast<char>(value | 0x80));
+    }
+    out.push_back(static_cast<char>(value));
+}
 
-    } else if (a->type == etype_t::divexpr) {
+bool get_varint(const std::string &in, std::size_t &off, std::uint64_t &value) {
+    value = 0;
+    for (std::uint32_t shift = 0; off < in.size() && shift < 64; shift += 7) {
+        const auto byte = static_cast<std::uint8_t>(in[off++]);
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) { return true; }
+    }
+    return false;
+}
 
-        /* expr / 1 */
-        if (a->exprs[1]->load() == dimreal_t{1}) {
-            a = std::move(a->exprs[0]);
-            goto redo;
-        }
+sptrexpr_t make_binary(etype_t type, sptrexpr_t a, sptrexpr_t b) {
+    switch (type) {
+        case etype_t::addexpr: return std::make_shared<addexpr_t>(std::move(a), std::move(b));
+        case etype_t::subexpr: return std::make_shared<subexpr_t>(std::move(a), std::move(b));
+        case etype_t::mulexpr: return std::make_shared<mulexpr_t>(std::move(a), std::move(b));
+        case etype_t::divexpr: return std::make_shared<divexpr_t>(std::move(a), std::move(b));
+        default: return std::make_shared<powexpr_t>(std::move(a), std::move(b));
+    }
+}
 
-        /* 1 / expr */
-        if (a->exprs[0]->load() == dimreal_t{1}) {
+/* what --complexity charges for a: one per node, one more per constant since there are more of those to pick from
+ * than operators, and a digit for every digit of an integer literal past the first (a whole precision's worth if
+ * it isn't one), never less than size()
+ */
+double description_length(const sptrexpr_t &a) {
+    double length = 1;
+    if (a->type == etype_t::cnstexpr) {
+        length += 1;
+    } else if (a->type == etype_t::litexpr) {
+        const mpreal &value = dynamic_cast<const litexpr_t&>(*a).value.value;
+        length += mpfr::isint(value) ? std::max(std::floor(log10_of(value)), 0.0) : digits_prec;
+    }
+    for (const sptrexpr_t &expr : a->exprs) {
+        length += description_length(expr);
+    }
+    return length;
+}
 
-            /* 1 / (expr / expr) */
-            if (a->exprs[1]->type == etype_t::divexpr) { /* invert it */
-                sptrexpr_t tmp = std::move(a->exprs[1]->exprs[0]);
-                a->exprs[1]->exprs[0] = std::move(a->exprs[1]->exprs[1]);
-                a->exprs[1]->exprs[1] = std::move(tmp);
-                a = std::move(a->exprs[1]);
-                goto redo;
-            }
+/* an expression in prefix order, one etype_t byte per node
+ * constants are followed by their index into the constant list as a varint, literals by their value as a zigzag varint
+ * (the enumeration only ever makes integer literals), and functions by their func_t byte
+ * a literal's unit isn't stored, only whether it has the dimension of the results (unit) or none, see expr_decoder_t
+ */
+static constexpr std::uint8_t ENCODED_UNIT_LITERAL = 0x80 | static_cast<std::uint8_t>(etype_t::litexpr);
+static constexpr std::uint8_t ENCODED_SCALAR_LITERAL = 0x40 | static_cast<std::uint8_t>(etype_t::litexpr);
 
+/* a has to be encodable, see encodable */
+void encode_expr(const sptrexpr_t &a, const std::vector<cnst_t> &list, const quantity &unit, std::string &out) {
+    if (a->type == etype_t::litexpr) {
+        const dimreal_t &value = std::dynamic_pointer_cast<litexpr_t>(a)->value;
+        const std::int64_t n = value.value.toLong();
+        std::uint8_t op = static_cast<std::uint8_t>(etype_t::litexpr);
+        if (value.unit.same_dimension(unit)) {
+            op = ENCODED_UNIT_LITERAL;
+        } else if (value.unit.same_dimension(quantity())) {
+            op = ENCODED_SCALAR_LITERAL;
         }
-
+        out.push_back(static_cast<char>(op));
+        put_varint(out, (static_cast<std::uint64_t>(n) << 1) ^ static_cast<std::uint64_t>(n >> 63));
+        return;
     }
-
-    for (sptrexpr_t &expr : a->exprs) {
-        simplify(expr);
+    out.push_back(static_cast<char>(a->type));
+    if (a->type == etype_t::unexpr) {
+        out.push_back(static_cast<char>(std::dynamic_pointer_cast<unexpr_t>(a)->func));
     }
-    return;
-
-    redo: {
-        simplify(a);
+    if (a->type == etype_t::cnstexpr) {
+        const std::string &name = std::dynamic_pointer_cast<cnstexpr_t>(a)->name;
+        auto pos = std::find_if(list.begin(), list.end(), [&](const cnst_t &constant) { return constant.name == name; });
+        put_varint(out, pos - list.begin());
+        return;
+    }
+    for (const sptrexpr_t &expr : a->exprs) {
+        encode_expr(expr, list, unit, out);
     }
 }
 
+std::string encode_expr(const sptrexpr_t &a, const std::vector<cnst_t> &list, const quantity &unit) {
+    std::string out;
+    encode_expr(a, list, unit, out);
+    return out;
+}
 
-void recurse(sptrexpr_t, std::uint32_t);
+/* the unit a literal gets back when decoded, from the other operand of its node */
+quantity literal_unit(etype_t type, bool second, const quantity &other, const quantity &unit) {
+    switch (type) {
+        case etype_t::addexpr: case etype_t::subexpr: return other;
+        case etype_t::mulexpr: return unit / other;
+        case etype_t::divexpr: return second ? other / unit : other * unit;
+        default: return quantity();
+    }
+}
 
-void test_expr(const sptrexpr_t& a, std::uint32_t cursize) {
-    const dimreal_t res = a->load();
-    const mpreal diff = cost(res.value, target->value);
-    if (res.unit.same_dimension(target->unit)) {
-        all.emplace_back(diff, a);
+/* whether decoding gives a back with the values and units its literals have now, see expr_decoder_t
+ * the encoding only holds integer literals below 2^62, anything else would come back as something else
+ */
+bool encodable(const sptrexpr_t &a, const quantity &unit) {
+    if (a->type == etype_t::cnstexpr) { return true; }
+    if (a->type == etype_t::litexpr) {
+        const mpreal &value = dynamic_cast<const litexpr_t&>(*a).value.value;
+        return mpfr::isint(value) && mpfr::abs(value) < mpfr::pow(mpreal(2), 62);
+    }
+    if (a->type == etype_t::unexpr) { return encodable(a->exprs[0], unit); }
+    if (a->exprs.size() != 2) { return false; }
+    for (std::size_t i = 0; i < 2; i++) {
+        const sptrexpr_t &expr = a->exprs[i];
+        if (!encodable(expr, unit)) { return false; }
+        if (expr->type != etype_t::litexpr) { continue; }
+        const quantity &lit_unit = expr->load().unit;
+        if (lit_unit.same_dimension(unit) || lit_unit.same_dimension(quantity())) { continue; }
+        const sptrexpr_t &other = a->exprs[1 - i];
+        if (other->type == etype_t::litexpr || a->type == etype_t::powexpr || !literal_unit(a->type, i == 1, other->load().unit, unit).same_dimension(lit_unit)) { return false; }
     }
-    recurse(a, cursize + 1);
+    return true;
 }
 
+/* rebuilds an encoded expression for a search whose results have the dimension of unit
+ * the seed of an expression always has that dimension, so a literal without it was added by recurse next to the
+ * rest of the expression and gets its unit back the same way: added to or subtracted from something it takes its unit,
+ * multiplied or divided by something it takes whatever makes the result come out as unit, and exponents are dimensionless
+ */
+struct expr_decoder_t {
+    const std::string &bytes;
+    const std::vector<cnst_t> &list;
+    const quantity &unit;
+    std::size_t off = 0;
 
-void recurse(sptrexpr_t b, std::uint32_t cursize = 1) {
-    if (cursize > max_expr_size) { return; }
-    for (const cnst_t &constant : constants) {
-        /* don't technically need to include constant - b or constant / b, 
-         * it's covered by the 0 - and 1 / cases in the next recursion
-         * however, we're not guaranteed another recursion due to limits on expr size
-         * so we do them here anyway
-         */
-        if (b->load().unit.same_dimension(quantity())) {
-            if (constant.value.unit.same_dimension(quantity())) {
-                if (constant.value.value > 0 || (constant.value.value < 0 && mpfr::isint(b->load().value))) {
-                    test_expr(std::make_shared<powexpr_t>(std::make_shared<cnstexpr_t>(constant), b), cursize);
+    /* a node, or just a literal's value while its unit depends on what it ends up next to */
+    struct piece_t {
+        sptrexpr_t expr;
+        std::int64_t literal = 0;
+    };
+
+    std::optional<piece_t> next() {
+        if (off >= bytes.size()) { return std::nullopt; }
+        const auto op = static_cast<std::uint8_t>(bytes[off++]);
+        const auto type = static_cast<etype_t>(op);
+        std::uint64_t value = 0;
+        if (op == ENCODED_UNIT_LITERAL || op == ENCODED_SCALAR_LITERAL || type == etype_t::litexpr) {
+            if (!get_varint(bytes, off, value)) { return std::nullopt; }
+            const auto n = static_cast<long>(static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1));
+            if (op == ENCODED_UNIT_LITERAL) {
+                return piece_t{std::make_shared<litexpr_t>(dimreal_t{mpreal(n), unit})};
+            }
+            if (op == ENCODED_SCALAR_LITERAL) {
+                return piece_t{std::make_shared<litexpr_t>(dimreal_t{mpreal(n)})};
+            }
+            return piece_t{nullptr, n};
+        }
+        switch (type) {
+            case etype_t::cnstexpr:
+                if (!get_varint(bytes, off, value) || value >= list.size()) { return std::nullopt; }
+                return piece_t{std::make_shared<cnstexpr_t>(list[value])};
+            case etype_t::unexpr: {
+                if (off >= bytes.size() || static_cast<std::uint8_t>(bytes[off]) >= static_cast<std::uint8_t>(func_t::count)) { return std::nullopt; }
+                const auto func = static_cast<func_t>(bytes[off++]);
+                std::optional<piece_t> arg = next();
+                if (!arg) { return std::nullopt; }
+                if (!arg->expr) {
+                    arg->expr = std::make_shared<litexpr_t>(dimreal_t{mpreal(arg->literal)});
                 }
-                if (b->load().value > 0 || (b->load().value < 0 && mpfr::isint(constant.value.value))) {
-                    test_expr(std::make_shared<powexpr_t>(b, std::make_shared<cnstexpr_t>(constant)), cursize);
+                return piece_t{std::make_shared<unexpr_t>(arg->expr, func)};
+            }
+            case etype_t::addexpr: case etype_t::subexpr: case etype_t::mulexpr: case etype_t::divexpr: case etype_t::powexpr: {
+                std::optional<piece_t> a = next(), b = next();
+                if (!a || !b || (!a->expr && !b->expr)) { return std::nullopt; }
+                if (!a->expr) {
+                    a->expr = std::make_shared<litexpr_t>(type == etype_t::powexpr ? dimreal_t{mpreal(a->literal)} : dimreal_t{mpreal(a->literal), literal_unit(type, false, b->expr->load().unit, unit)});
                 }
-                if (mpfr::isint(constant.value.value)) {
-                    test_expr(std::make_shared<powexpr_t>(b, std::make_shared<cnstexpr_t>(constant)), cursize);
+                if (!b->expr) {
+                    b->expr = std::make_shared<litexpr_t>(type == etype_t::powexpr ? dimreal_t{mpreal(b->literal)} : dimreal_t{mpreal(b->literal), literal_unit(type, true, a->expr->load().unit, unit)});
                 }
+                return piece_t{make_binary(type, a->expr, b->expr)};
             }
-            if (mpfr::isint(b->load().value)) {
-                test_expr(std::make_shared<powexpr_t>(std::make_shared<cnstexpr_t>(constant), b), cursize);
-            }
-        }
-        test_expr(std::make_shared<mulexpr_t>(b, std::make_shared<cnstexpr_t>(constant)), cursize);
-        if (constant.value.value != 0) {
-            test_expr(std::make_shared<divexpr_t>(b, std::make_shared<cnstexpr_t>(constant)), cursize);
-        }
-        if (b->load().value != 0) {
-            test_expr(std::make_shared<divexpr_t>(std::make_shared<cnstexpr_t>(constant), b), cursize);
+            default:
+                return std::nullopt;
         }
-        if (constant.value.unit.same_dimension(b->load().unit)) {
-            test_expr(std::make_shared<addexpr_t>(b, std::make_shared<cnstexpr_t>(constant)), cursize);
-            test_expr(std::make_shared<subexpr_t>(b, std::make_shared<cnstexpr_t>(constant)), cursize);
-            test_expr(std::make_shared<subexpr_t>(std::make_shared<cnstexpr_t>(constant), b), cursize);
+    }
+};
+
+/* nullptr if bytes aren't a whole encoded expression */
+sptrexpr_t decode_expr(const std::string &bytes, const std::vector<cnst_t> &list, const quantity &unit) {
+    expr_decoder_t decoder{bytes, list, unit};
+    std::optional<expr_decoder_t::piece_t> piece = decoder.next();
+    if (!piece || !piece->expr || decoder.off != bytes.size()) { return nullptr; }
+    return piece->expr;
+}
+
+/* the results of one search, or one shard of it
+ * "EXRS", version, precision, digits, the config string, shard, then the constants so the expressions decode on their own,
+ * and per target its name, value, unit and results, each result its error and value at the file's precision, size, seed and expression
+ */
+struct results_file_t {
+    static constexpr const char magic[4] = {'E', 'X', 'R', 'S'};
+    static constexpr std::uint32_t version = 2;
+
+    struct entry_t {
+        mpreal err, value;
+        std::uint32_t size, seed;
+        double length; /* see result_t */
+        std::string expr; /* encoded */
+    };
+
+    struct target_t {
+        std::string name;
+        dimreal_t value;
+        std::vector<entry_t> results;
+    };
+
+    mpfr_prec_t prec = 0;
+    std::int32_t digits = 0;
+    std::string config;
+    std::uint32_t shard_index = 0, shard_count = 1;
+    std::vector<cnst_t> cnsts; /* the search's constants, named apart from the global */
+    std::vector<target_t> targets;
+
+    void add(const std::string &name, const dimreal_t &target, const topk_t &results) {
+        target_t &added = targets.emplace_back(target_t{name, target, {}});
+        for (const result_t &item : results.items) {
+            if (!encodable(item.expr, target.unit)) { continue; }
+            added.results.push_back(entry_t{item.err, item.expr->load().value, item.size, item.seed, item.length, encode_expr(item.expr, cnsts, target.unit)});
+        }
+    }
+
+    void write(const std::string &filename) const {
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        file.write(magic, sizeof(magic));
+        write_pod(file, version);
+        write_pod(file, static_cast<std::int64_t>(prec));
+        write_pod(file, digits);
+        write_str(file, config);
+        write_pod(file, shard_index);
+        write_pod(file, shard_count);
+        write_cnst_list(file, cnsts, prec);
+        write_pod(file, static_cast<std::uint32_t>(targets.size()));
+        for (const target_t &target : targets) {
+            write_str(file, target.name);
+            write_raw(file, target.value.value, prec);
+            write_unit(file, target.value.unit);
+            write_pod(file, static_cast<std::uint32_t>(target.results.size()));
+            for (const entry_t &entry : target.results) {
+                write_raw(file, entry.err, prec);
+                write_raw(file, entry.value, prec);
+                write_pod(file, entry.size);
+                write_pod(file, entry.seed);
+                write_pod(file, entry.length);
+                write_str(file, entry.expr);
+            }
+        }
+    }
+
+    /* sets the default precision to the file's, nullopt if it's not a results file or is cut short */
+    static std::optional<results_file_t> read(const std::string &filename) {
+        std::ifstream file(filename, std::ios::binary);
+        results_file_t results;
+        char fmagic[4];
+        std::uint32_t fversion = 0, target_count = 0;
+        std::int64_t fprec = 0;
+        if (!file.read(fmagic, sizeof(fmagic)) || std::memcmp(fmagic, magic, sizeof(magic)) != 0) { return std::nullopt; }
+        if (!read_pod(file, fversion) || fversion != version || !read_pod(file, fprec) || fprec < MPFR_PREC_MIN || fprec > MPFR_PREC_MAX) { return std::nullopt; }
+        results.prec = static_cast<mpfr_prec_t>(fprec);
+        mpreal::set_default_prec(results.prec);
+        if (!read_pod(file, results.digits) || !read_str(file, results.config) || !read_pod(file, results.shard_index) || !read_pod(file, results.shard_count)) { return std::nullopt; }
+        if (!read_cnst_list(file, results.cnsts, results.prec) || !read_pod(file, target_count)) { return std::nullopt; }
+        for (std::uint32_t i = 0; i < target_count; i++) {
+            std::string name;
+            mpreal value;
+            std::uint32_t count = 0;
+            if (!read_str(file, name) || !read_raw(file, results.prec, value)) { return std::nullopt; }
+            std::optional<quantity> unit = read_unit(file);
+            if (!unit || !read_pod(file, count)) { return std::nullopt; }
+            target_t target{name, dimreal_t{value, *unit}, {}};
+            for (std::uint32_t j = 0; j < count; j++) {
+                entry_t entry;
+                if (!read_raw(file, results.prec, entry.err) || !read_raw(file, results.prec, entry.value) || !read_pod(file, entry.size) || !read_pod(file, entry.seed) || !read_pod(file, entry.length) || !read_str(file, entry.expr)) { return std::nullopt; }
+                target.results.push_back(std::move(entry));
+            }
+            results.targets.push_back(std::move(target));
+        }
+        return results;
+    }
+
+    sptrexpr_t decode(const target_t &target, const entry_t &entry) const {
+        return decode_expr(entry.expr, cnsts, target.value.unit);
+    }
+};
+
+/* the rewrite stage, run on results as they're kept so equivalent ones collapse before they're compared
+ * rules only look at node types and literals, never load() anything, and build new nodes rather than changing the ones
+ * they match since subtrees are shared between candidates
+ */
+const litexpr_t *as_literal(const sptrexpr_t &a) {
+    return a->type == etype_t::litexpr ? dynamic_cast<const litexpr_t*>(a.get()) : nullptr;
+}
+
+/* a literal equal to n, and dimensionless unless n is 0 since 0 of any unit can be dropped from a sum */
+bool is_literal(const sptrexpr_t &a, long n) {
+    const litexpr_t *lit = as_literal(a);
+    return lit && lit->value.value == n && (n == 0 || lit->value.unit.same_dimension(quantity()));
+}
+
+/* 0 - a */
+bool is_negation(const sptrexpr_t &a) {
+    return a->type == etype_t::subexpr && is_literal(a->exprs[0], 0);
+}
+
+bool is_negative_literal(const sptrexpr_t &a) {
+    const litexpr_t *lit = as_literal(a);
+    return lit && lit->value.value < 0;
+}
+
+sptrexpr_t negated_literal(const sptrexpr_t &a) {
+    return std::make_shared<litexpr_t>(-as_literal(a)->value);
+}
+
+/* two literals as one, as long as the result is still an integer literal the encoding can hold */
+sptrexpr_t fold_literals(const sptrexpr_t &a) {
+    const litexpr_t *x = as_literal(a->exprs[0]), *y = as_literal(a->exprs[1]);
+    if (!x || !y) { return nullptr; }
+    const dimreal_t &l = x->value, &r = y->value;
+    std::optional<dimreal_t> folded;
+    switch (a->type) {
+        case etype_t::addexpr: if (l.unit.same_dimension(r.unit)) { folded.emplace(l + r); } break;
+        case etype_t::subexpr: if (l.unit.same_dimension(r.unit)) { folded.emplace(l - r); } break;
+        case etype_t::mulexpr: folded.emplace(l * r); break;
+        case etype_t::divexpr: if (r.value != 0) { folded.emplace(l / r); } break;
+        case etype_t::powexpr:
+            if (r.value >= 0 && r.value <= 62 && r.unit.same_dimension(quantity()) && l.unit.same_dimension(quantity())) {
+                folded.emplace(l.pow(r));
+            }
+            break;
+        default: break;
+    }
+    if (!folded || !mpfr::isint(folded->value) || mpfr::abs(folded->value) >= mpfr::pow(mpreal(2), 62)) { return nullptr; }
+    return std::make_shared<litexpr_t>(*folded);
+}
+
+struct rewrite_rule_t {
+    const char *pattern;
+    etype_t type;
+    sptrexpr_t (*apply)(const sptrexpr_t &a); /* the replacement, nullptr if a doesn't match */
+};
+
+static const rewrite_rule_t REWRITE_RULES[] = {
+    {"lit op lit", etype_t::addexpr, fold_literals},
+    {"lit op lit", etype_t::subexpr, fold_literals},
+    {"lit op lit", etype_t::mulexpr, fold_literals},
+    {"lit op lit", etype_t::divexpr, fold_literals},
+    {"lit op lit", etype_t::powexpr, fold_literals},
+
+    {"0 + a", etype_t::addexpr, [](const sptrexpr_t &a) { return is_literal(a->exprs[0], 0) ? a->exprs[1] : nullptr; }},
+    {"a + 0", etype_t::addexpr, [](const sptrexpr_t &a) { return is_literal(a->exprs[1], 0) ? a->exprs[0] : nullptr; }},
+    {"a - 0", etype_t::subexpr, [](const sptrexpr_t &a) { return is_literal(a->exprs[1], 0) ? a->exprs[0] : nullptr; }},
+    {"1 * a", etype_t::mulexpr, [](const sptrexpr_t &a) { return is_literal(a->exprs[0], 1) ? a->exprs[1] : nullptr; }},
+    {"a * 1", etype_t::mulexpr, [](const sptrexpr_t &a) { return is_literal(a->exprs[1], 1) ? a->exprs[0] : nullptr; }},
+    {"a / 1", etype_t::divexpr, [](const sptrexpr_t &a) { return is_literal(a->exprs[1], 1) ? a->exprs[0] : nullptr; }},
+    {"a ^ 1", etype_t::powexpr, [](const sptrexpr_t &a) { return is_literal(a->exprs[1], 1) ? a->exprs[0] : nullptr; }},
+    {"1 / (a / b)", etype_t::divexpr, [](const sptrexpr_t &a) -> sptrexpr_t {
+        if (!is_literal(a->exprs[0], 1) || a->exprs[1]->type != etype_t::divexpr) { return nullptr; }
+        return std::make_shared<divexpr_t>(a->exprs[1]->exprs[1], a->exprs[1]->exprs[0]);
+    }},
+
+    /* signs, so a negation ends up as one subtraction or one negative literal */
+    {"0 - (0 - a)", etype_t::subexpr, [](const sptrexpr_t &a) { return is_literal(a->exprs[0], 0) && is_negation(a->exprs[1]) ? a->exprs[1]->exprs[1] : nullptr; }},
+    {"0 - lit", etype_t::subexpr, [](const sptrexpr_t &a) { return is_literal(a->exprs[0], 0) && as_literal(a->exprs[1]) ? negated_literal(a->exprs[1]) : nullptr; }},
+    {"a - (0 - b)", etype_t::subexpr, [](const sptrexpr_t &a) -> sptrexpr_t {
+        return is_negation(a->exprs[1]) ? std::make_shared<addexpr_t>(a->exprs[0], a->exprs[1]->exprs[1]) : nullptr;
+    }},
+    {"a + (0 - b)", etype_t::addexpr, [](const sptrexpr_t &a) -> sptrexpr_t {
+        return is_negation(a->exprs[1]) ? std::make_shared<subexpr_t>(a->exprs[0], a->exprs[1]->exprs[1]) : nullptr;
+    }},
+    {"(0 - a) + b", etype_t::addexpr, [](const sptrexpr_t &a) -> sptrexpr_t {
+        return is_negation(a->exprs[0]) ? std::make_shared<subexpr_t>(a->exprs[1], a->exprs[0]->exprs[1]) : nullptr;
+    }},
+    {"a - -lit", etype_t::subexpr, [](const sptrexpr_t &a) -> sptrexpr_t {
+        return is_negative_literal(a->exprs[1]) ? std::make_shared<addexpr_t>(a->exprs[0], negated_literal(a->exprs[1])) : nullptr;
+    }},
+    {"a + -lit", etype_t::addexpr, [](const sptrexpr_t &a) -> sptrexpr_t {
+        return is_negative_literal(a->exprs[1]) ? std::make_shared<subexpr_t>(a->exprs[0], negated_literal(a->exprs[1])) : nullptr;
+    }},
+};
+
+/* children first, then the first rule that matches the node, over again until none does
+ * every rule makes the tree smaller or takes out a negative literal, so this ends
+ */
+sptrexpr_t rewrite(const sptrexpr_t &a) {
+    if (a->type == etype_t::unexpr) {
+        const sptrexpr_t arg = rewrite(a->exprs[0]);
+        return arg == a->exprs[0] ? a : std::make_shared<unexpr_t>(arg, std::dynamic_pointer_cast<unexpr_t>(a)->func);
+    }
+    if (a->exprs.size() != 2 || a->type == etype_t::none) { return a; }
+    const sptrexpr_t l = rewrite(a->exprs[0]), r = rewrite(a->exprs[1]);
+    const sptrexpr_t node = l == a->exprs[0] && r == a->exprs[1] ? a : make_binary(a->type, l, r);
+    for (const rewrite_rule_t &rule : REWRITE_RULES) {
+        if (rule.type != node->type) { continue; }
+        if (sptrexpr_t next = rule.apply(node)) {
+            count_stat(stat_t::rewrites);
+            return rewrite(next);
+        }
+    }
+    return node;
+}
+
+void simplify(sptrexpr_t &a) {
+    a = rewrite(a);
+}
+
+
+/* equality saturation over the expression node types
+ * an e-class is a set of expressions known to be equal and an e-node is an operator over e-classes, or a leaf
+ * the rules add every rearrangement of every node until nothing new turns up or the graph hits its limits, after which
+ * two expressions are equal (as far as the rules can tell) exactly when they're in the same e-class
+ */
+struct egraph_t {
+    static constexpr std::size_t max_nodes = 2000;
+    static constexpr std::uint32_t max_iterations = 8;
+
+    struct enode_t {
+        etype_t type;
+        std::uint32_t a = 0, b = 0; /* child e-classes, or for a leaf a is its index in leaves */
+
+        bool operator==(const enode_t &other) const = default;
+    };
+
+    struct enode_hash_t {
+        std::size_t operator()(const enode_t &n) const {
+            return (static_cast<std::size_t>(n.type) * 0x9e3779b97f4a7c15ULL) ^ (static_cast<std::size_t>(n.a) << 32) ^ n.b;
+        }
+    };
+
+    std::vector<sptrexpr_t> leaves;
+    std::vector<std::uint32_t> parent; /* union-find over e-class ids, a root's id is the smallest in its set */
+    std::vector<std::vector<enode_t>> nodes; /* of each root */
+    std::unordered_map<enode_t, std::uint32_t, enode_hash_t> memo;
+    std::size_t node_count = 0;
+
+    static bool is_leaf(etype_t type) {
+        return type == etype_t::litexpr || type == etype_t::cnstexpr || type == etype_t::unexpr || type == etype_t::none;
+    }
+
+    std::uint32_t find(std::uint32_t id) {
+        while (parent[id] != id) {
+            id = parent[id] = parent[parent[id]];
+        }
+        return id;
+    }
+
+    enode_t canonical(enode_t n) {
+        if (!is_leaf(n.type)) {
+            n.a = find(n.a);
+            n.b = find(n.b);
+        }
+        return n;
+    }
+
+    std::uint32_t add(enode_t n) {
+        n = canonical(n);
+        if (auto it = memo.find(n); it != memo.end()) { return find(it->second); }
+        const auto id = static_cast<std::uint32_t>(parent.size());
+        parent.push_back(id);
+        nodes.push_back({n});
+        memo.emplace(n, id);
+        node_count++;
+        return id;
+    }
+
+    std::uint32_t add(etype_t type, std::uint32_t a, std::uint32_t b) {
+        return add(enode_t{type, a, b});
+    }
+
+    std::uint32_t add_leaf(const sptrexpr_t &a) {
+        auto it = std::find_if(leaves.begin(), leaves.end(), [&](const sptrexpr_t &leaf) { return *leaf == *a; });
+        if (it == leaves.end()) {
+            leaves.push_back(a);
+            it = std::prev(leaves.end());
+        }
+        return add(enode_t{a->type, static_cast<std::uint32_t>(it - leaves.begin())});
+    }
+
+    /* whole subtrees under anything the rules don't know are leaves too */
+    std::uint32_t add(const sptrexpr_t &a) {
+        if (is_leaf(a->type) || a->exprs.size() != 2) { return add_leaf(a); }
+        const std::uint32_t l = add(a->exprs[0]), r = add(a->exprs[1]);
+        return add(a->type, l, r);
+    }
+
+    bool merge(std::uint32_t x, std::uint32_t y) {
+        x = find(x), y = find(y);
+        if (x == y) { return false; }
+        if (y < x) {
+            std::swap(x, y);
+        }
+        parent[y] = x;
+        nodes[x].insert(nodes[x].end(), nodes[y].begin(), nodes[y].end());
+        nodes[y].clear();
+        return true;
+    }
+
+    /* merges brought nodes with the same operator over the same classes into different classes, those are merged too
+     * once the pass over the classes is done, since a merge empties the node list of one of them
+     */
+    void rebuild() {
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> congruent;
+        for (bool changed = true; changed;) {
+            changed = false;
+            memo.clear();
+            congruent.clear();
+            for (std::uint32_t id = 0; id < nodes.size(); id++) {
+                if (find(id) != id) { continue; }
+                for (enode_t &n : nodes[id]) {
+                    n = canonical(n);
+                    auto [it, inserted] = memo.emplace(n, id);
+                    if (!inserted && it->second != id) {
+                        congruent.emplace_back(it->second, id);
+                    }
+                }
+            }
+            for (const auto &[x, y] : congruent) {
+                changed = merge(x, y) || changed;
+            }
+        }
+        node_count = 0;
+        for (std::uint32_t id = 0; id < nodes.size(); id++) {
+            std::vector<enode_t> &list = nodes[id];
+            std::sort(list.begin(), list.end(), [](const enode_t &x, const enode_t &y) { return std::tie(x.type, x.a, x.b) < std::tie(y.type, y.a, y.b); });
+            list.erase(std::unique(list.begin(), list.end()), list.end());
+            node_count += list.size();
+        }
+    }
+
+    std::size_t class_count() {
+        std::size_t count = 0;
+        for (std::uint32_t id = 0; id < nodes.size(); id++) {
+            count += find(id) == id;
+        }
+        return count;
+    }
+
+    /* the literal in an e-class, if it has one */
+    sptrexpr_t literal(std::uint32_t id) {
+        for (const enode_t &n : nodes[find(id)]) {
+            if (n.type == etype_t::litexpr) { return leaves[n.a]; }
+        }
+        return nullptr;
+    }
+
+    void saturate();
+
+    /* the smallest expression in each e-class, ties going to the one that renders first, so the pick only depends on
+     * what's in the class and not on the order it was added in
+     */
+    struct best_t {
+        std::uint32_t size = 0; /* 0 while nothing in the class has been costed */
+        std::string key;
+        enode_t node{};
+    };
+
+    std::vector<best_t> extract() {
+        std::vector<best_t> best(nodes.size());
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (std::uint32_t id = 0; id < nodes.size(); id++) {
+                if (find(id) != id) { continue; }
+                for (const enode_t &n : nodes[id]) {
+                    best_t candidate{1, "", n};
+                    if (is_leaf(n.type)) {
+                        candidate.key = leaves[n.a]->disp();
+                    } else {
+                        const best_t &l = best[find(n.a)], &r = best[find(n.b)];
+                        if (l.size == 0 || r.size == 0) { continue; }
+                        candidate.size += l.size + r.size;
+                        candidate.key = "(" + l.key + ' ' + std::to_string(static_cast<std::uint32_t>(n.type)) + ' ' + r.key + ")";
+                    }
+                    best_t &current = best[id];
+                    if (current.size == 0 || candidate.size < current.size || (candidate.size == current.size && candidate.key < current.key)) {
+                        current = std::move(candidate);
+                        changed = true;
+                    }
+                }
+            }
+        }
+        return best;
+    }
+
+    sptrexpr_t build(const std::vector<best_t> &best, std::uint32_t id) {
+        const enode_t &n = best[find(id)].node;
+        if (is_leaf(n.type)) { return leaves[n.a]; }
+        return make_binary(n.type, build(best, n.a), build(best, n.b));
+    }
+};
+
+struct egraph_rule_t {
+    const char *pattern;
+    etype_t type;
+    void (*apply)(egraph_t &g, std::uint32_t id, const egraph_t::enode_t &n);
+};
+
+/* the nodes of type in the e-class, copied since applying a rule can change the class */
+std::vector<egraph_t::enode_t> nodes_of(egraph_t &g, std::uint32_t id, etype_t type) {
+    std::vector<egraph_t::enode_t> out;
+    for (const egraph_t::enode_t &m : g.nodes[g.find(id)]) {
+        if (m.type == type) {
+            out.push_back(m);
+        }
+    }
+    return out;
+}
+
+static const egraph_rule_t EGRAPH_RULES[] = {
+    {"a + b = b + a", etype_t::addexpr, [](egraph_t &g, std::uint32_t id, const egraph_t::enode_t &n) { g.merge(id, g.add(etype_t::addexpr, n.b, n.a)); }},
+    {"a * b = b * a", etype_t::mulexpr, [](egraph_t &g, std::uint32_t id, const egraph_t::enode_t &n) { g.merge(id, g.add(etype_t::mulexpr, n.b, n.a)); }},
+    {"(a + b) + c = a + (b + c)", etype_t::addexpr, [](egraph_t &g, std::uint32_t id, const egraph_t::enode_t &n) {
+        for (const egraph_t::enode_t &m : nodes_of(g, n.a, etype_t::addexpr)) {
+            g.merge(id, g.add(etype_t::addexpr, m.a, g.add(etype_t::addexpr, m.b, n.b)));
+        }
+    }},
+    {"(a * b) * c = a * (b * c)", etype_t::mulexpr, [](egraph_t &g, std::uint32_t id, const egraph_t::enode_t &n) {
+        for (const egraph_t::enode_t &m : nodes_of(g, n.a, etype_t::mulexpr)) {
+            g.merge(id, g.add(etype_t::mulexpr, m.a, g.add(etype_t::mulexpr, m.b, n.b)));
+        }
+    }},
+    {"(a - b) + c = (a + c) - b", etype_t::addexpr, [](egraph_t &g, std::uint32_t id, const egraph_t::enode_t &n) {
+        for (const egraph_t::enode_t &m : nodes_of(g, n.a, etype_t::subexpr)) {
+            g.merge(id, g.add(etype_t::subexpr, g.add(etype_t::addexpr, m.a, n.b), m.b));
+        }
+    }},
+    {"(a + b) - c = a + (b - c)", etype_t::subexpr, [](egraph_t &g, std::uint32_t id, const egraph_t::enode_t &n) {
+        for (const egraph_t::enode_t &m : nodes_of(g, n.a, etype_t::addexpr)) {
+            g.merge(id, g.add(etype_t::addexpr, m.a, g.add(etype_t::subexpr, m.b, n.b)));
+        }
+    }},
+    {"(a - b) - c = a - (b + c)", etype_t::subexpr, [](egraph_t &g, std::uint32_t id, const egraph_t::enode_t &n) {
+        for (const egraph_t::enode_t &m : nodes_of(g, n.a, etype_t::subexpr)) {
+            g.merge(id, g.add(etype_t::subexpr, m.a, g.add(etype_t::addexpr, m.b, n.b)));
+        }
+    }},
+    {"a - (b - c) = (a + c) - b", etype_t::subexpr, [](egraph_t &g, std::uint32_t id, const egraph_t::enode_t &n) {
+        for (const egraph_t::enode_t &m : nodes_of(g, n.b, etype_t::subexpr)) {
+            g.merge(id, g.add(etype_t::subexpr, g.add(etype_t::addexpr, n.a, m.b), m.a));
+        }
+    }},
+    {"(a * b) / c = a * (b / c)", etype_t::divexpr, [](egraph_t &g, std::uint32_t id, const egraph_t::enode_t &n) {
+        for (const egraph_t::enode_t &m : nodes_of(g, n.a, etype_t::mulexpr)) {
+            g.merge(id, g.add(etype_t::mulexpr, m.a, g.add(etype_t::divexpr, m.b, n.b)));
+        }
+    }},
+    {"(a / b) * c = (a * c) / b", etype_t::mulexpr, [](egraph_t &g, std::uint32_t id, const egraph_t::enode_t &n) {
+        for (const egraph_t::enode_t &m : nodes_of(g, n.a, etype_t::divexpr)) {
+            g.merge(id, g.add(etype_t::divexpr, g.add(etype_t::mulexpr, m.a, n.b), m.b));
+        }
+    }},
+    {"(a / b) / c = a / (b * c)", etype_t::divexpr, [](egraph_t &g, std::uint32_t id, const egraph_t::enode_t &n) {
+        for (const egraph_t::enode_t &m : nodes_of(g, n.a, etype_t::divexpr)) {
+            g.merge(id, g.add(etype_t::divexpr, m.a, g.add(etype_t::mulexpr, m.b, n.b)));
+        }
+    }},
+    {"a / (b / c) = (a * c) / b", etype_t::divexpr, [](egraph_t &g, std::uint32_t id, const egraph_t::enode_t &n) {
+        for (const egraph_t::enode_t &m : nodes_of(g, n.b, etype_t::divexpr)) {
+            g.merge(id, g.add(etype_t::divexpr, g.add(etype_t::mulexpr, n.a, m.b), m.a));
+        }
+    }},
+};
+
+/* rules that apply to every binary node: literals folded, and the identities the rearrangements can turn up */
+void apply_literal_rules(egraph_t &g, std::uint32_t id, const egraph_t::enode_t &n) {
+    const sptrexpr_t l = g.literal(n.a), r = g.literal(n.b);
+    if (l && r) {
+        if (sptrexpr_t folded = fold_literals(make_binary(n.type, l, r))) {
+            g.merge(id, g.add_leaf(folded));
+        }
+    }
+    switch (n.type) {
+        case etype_t::addexpr: case etype_t::subexpr:
+            if (r && is_literal(r, 0)) {
+                g.merge(id, n.a);
+            }
+            break;
+        case etype_t::mulexpr: case etype_t::divexpr: case etype_t::powexpr:
+            if (r && is_literal(r, 1)) {
+                g.merge(id, n.a);
+            }
+            break;
+        default: break;
+    }
+}
+
+void egraph_t::saturate() {
+    for (std::uint32_t iteration = 0; iteration < max_iterations && node_count < max_nodes; iteration++) {
+        const std::size_t added = nodes.size(), classes = class_count();
+        std::vector<std::pair<std::uint32_t, enode_t>> matches;
+        for (std::uint32_t id = 0; id < nodes.size(); id++) {
+            if (find(id) != id) { continue; }
+            for (const enode_t &n : nodes[id]) {
+                if (!is_leaf(n.type)) {
+                    matches.emplace_back(id, n);
+                }
+            }
+        }
+        for (const auto &[id, n] : matches) {
+            if (node_count >= max_nodes) { break; }
+            for (const egraph_rule_t &rule : EGRAPH_RULES) {
+                if (rule.type == n.type) {
+                    rule.apply(*this, id, n);
+                }
+            }
+            apply_literal_rules(*this, id, n);
+        }
+        rebuild();
+        /* no new e-class and none merged, the graph is saturated */
+        if (nodes.size() == added && class_count() == classes) { break; }
+    }
+}
+
+equivalence_t equivalence(const sptrexpr_t &a) {
+    if (!use_egraph) {
+        return equivalence_t{a->disp(), a};
+    }
+    egraph_t g;
+    const std::uint32_t root = g.add(a);
+    g.saturate();
+    const std::vector<egraph_t::best_t> best = g.extract();
+    return equivalence_t{best[g.find(root)].key, g.build(best, root)};
+}
+
+std::chrono::steady_clock::time_point search_start;
+
+/* candidates evaluated across all threads, workers add theirs in batches */
+std::atomic_uint64_t candidates_evaluated = 0;
+
+/* reports every improvement to the best result so far while the search runs
+ * lines are printed by a dedicated thread, workers only ever hold a lock long enough to queue one
+ */
+struct stream_t {
+    struct event_t {
+        sptrexpr_t expr;
+        mpreal err;
+        double elapsed;
+        std::uint64_t evaluated;
+    };
+
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    std::deque<event_t> queue;
+    bool done = false;
+    std::thread writer;
+
+    std::mutex best_mutex;
+    std::optional<mpreal> best;
+    /* exponent of the best error, lets most candidates be turned away without taking the lock */
+    std::atomic<mpfr_exp_t> best_exp = std::numeric_limits<mpfr_exp_t>::max();
+
+    void start() {
+        writer = std::thread([this]() {
+            std::unique_lock lock(queue_mutex);
+            while (true) {
+                queue_cv.wait(lock, [this]() { return done || !queue.empty(); });
+                if (queue.empty()) { return; }
+                event_t event = std::move(queue.front());
+                queue.pop_front();
+                lock.unlock();
+                std::printf("[%.3fs, %" PRIu64 " candidates] %s | err: %s\n", event.elapsed, event.evaluated, event.expr->disp().c_str(), event.err.toString(digits_prec).c_str());
+                std::fflush(stdout);
+                lock.lock();
+            }
+        });
+    }
+
+    void finish() {
+        {
+            std::lock_guard lock(queue_mutex);
+            done = true;
+        }
+        queue_cv.notify_one();
+        writer.join();
+    }
+
+    void offer(const mpreal &err, const sptrexpr_t &a, std::uint64_t evaluated) {
+        const bool zero = mpfr_zero_p(err.mpfr_srcptr());
+        if (!zero && mpfr_get_exp(err.mpfr_srcptr()) > best_exp.load(std::memory_order_relaxed)) { return; }
+        {
+            std::lock_guard lock(best_mutex);
+            if (best && err >= *best) { return; }
+            best = err;
+            best_exp.store(zero ? std::numeric_limits<mpfr_exp_t>::min() : mpfr_get_exp(err.mpfr_srcptr()), std::memory_order_relaxed);
+        }
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - search_start).count();
+        {
+            std::lock_guard lock(queue_mutex);
+            queue.push_back(event_t{a, err, elapsed, evaluated});
+        }
+        queue_cv.notify_one();
+    }
+};
+
+std::unique_ptr<stream_t> stream;
+
+/* early termination, any of these being hit stops every worker and the results so far are reported */
+std::optional<mpreal> max_error;
+std::optional<mpreal> max_rel_error;
+std::uint64_t max_candidates = 0;
+double time_budget = 0; /* seconds */
+
+std::atomic_bool stop_search = false;
+const char *stop_reason = nullptr;
+
+void request_stop(const char *reason) {
+    if (!stop_search.exchange(true)) {
+        stop_reason = reason;
+    }
+}
+
+/* --collect, every candidate within collect_error of the target instead of just the best few
+ * workers buffer what they find and write it out as a sorted run whenever their share of collect_memory fills,
+ * then the runs are merged into one sorted, deduplicated text file once the search is done
+ */
+std::optional<mpreal> collect_error;
+std::size_t collect_memory = std::size_t{256} << 20; /* bytes */
+
+struct collected_t {
+    mpreal err;
+    std::string expr; /* encoded, see encode_expr */
+
+    bool operator<(const collected_t &other) const {
+        return err < other.err || (err == other.err && expr < other.expr);
+    }
+
+    bool operator==(const collected_t &other) const {
+        return err == other.err && expr == other.expr;
+    }
+
+    /* on the heap, past the collected_t itself, which is counted with the vector holding it */
+    std::size_t bytes() const {
+        return mpfr_custom_get_size(err.get_prec()) + expr.capacity();
+    }
+};
+
+struct collector_t {
+    static constexpr const char magic[4] = {'E', 'X', 'C', 'R'};
+    static constexpr std::uint32_t version = 1;
+
+    std::string prefix; /* run files are <prefix>.run-<n> */
+    mpfr_prec_t prec;
+    quantity unit; /* of the target, for decoding */
+    std::size_t worker_memory; /* each worker's share of collect_memory */
+    std::atomic_uint32_t next_run = 0;
+    std::mutex runs_mutex;
+    std::vector<std::string> runs;
+
+    collector_t(std::string prefix, const quantity &unit, std::int32_t thread_count)
+        : prefix(std::move(prefix)), prec(mpreal::get_default_prec()), unit(unit), worker_memory(collect_memory / thread_count) {}
+
+    /* every run file still on disk, so they can all be removed if anything goes wrong */
+    void remove_runs() {
+        std::lock_guard lock(runs_mutex);
+        for (const std::string &run : runs) {
+            std::error_code ec;
+            std::filesystem::remove(run, ec);
+        }
+        runs.clear();
+    }
+
+    /* a new run file, already in runs */
+    std::ofstream create_run(std::string &filename) {
+        filename = prefix + ".run-" + std::to_string(next_run++);
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        {
+            std::lock_guard lock(runs_mutex);
+            runs.push_back(filename);
+        }
+        if (!file) {
+            remove_runs();
+            ERR_EXIT(err_t::collect_file, "could not write run file \"%s\": %s", filename.c_str(), std::strerror(errno))
+        }
+        file.write(magic, sizeof(magic));
+        write_pod(file, version);
+        return file;
+    }
+
+    void write_item(std::ofstream &file, const collected_t &item) const {
+        write_raw(file, item.err, prec);
+        write_str(file, item.expr);
+    }
+
+    void close_run(std::ofstream &file, const std::string &filename) {
+        file.close();
+        if (!file) {
+            remove_runs();
+            ERR_EXIT(err_t::collect_file, "could not write run file \"%s\": %s", filename.c_str(), std::strerror(errno))
+        }
+    }
+
+    void spill(std::vector<collected_t> &items) {
+        if (items.empty()) { return; }
+        std::sort(items.begin(), items.end());
+        items.erase(std::unique(items.begin(), items.end()), items.end());
+
+        std::string filename;
+        std::ofstream file = create_run(filename);
+        for (const collected_t &item : items) {
+            write_item(file, item);
+        }
+        close_run(file, filename);
+        items.clear();
+        items.shrink_to_fit();
+    }
+
+    struct run_t {
+        std::ifstream file;
+        collected_t head;
+        bool cut_short = false;
+
+        /* false at the end of the run, or partway through an entry, which sets cut_short */
+        bool next(mpfr_prec_t prec) {
+            if (file.peek() == std::ifstream::traits_type::eof()) { return false; }
+            cut_short = !read_raw(file, prec, head.err) || !read_str(file, head.expr);
+            return !cut_short;
+        }
+    };
+
+    /* the most runs merged at once, more could run into the limit on open files, half of which is left for the rest */
+    static std::size_t max_fan_in() {
+        rlimit limit{};
+        if (getrlimit(RLIMIT_NOFILE, &limit) != 0 || limit.rlim_cur == RLIM_INFINITY) { return 64; }
+        return std::clamp<std::size_t>(limit.rlim_cur / 2, 2, 64);
+    }
+
+    /* k-way merge of inputs, handing each entry to emit in order with repeats dropped */
+    void merge_runs(const std::vector<std::string> &inputs, const std::function<void (const collected_t&)> &emit) {
+        std::vector<run_t> open(inputs.size());
+        auto later = [&](std::size_t a, std::size_t b) { return open[b].head < open[a].head; };
+        std::priority_queue<std::size_t, std::vector<std::size_t>, decltype(later)> heads(later);
+        auto advance = [&](std::size_t i) {
+            if (open[i].next(prec)) {
+                heads.push(i);
+            } else if (open[i].cut_short) {
+                remove_runs();
+                ERR_EXIT(err_t::collect_file, "run file \"%s\" is cut short", inputs[i].c_str())
+            }
+        };
+        for (std::size_t i = 0; i < inputs.size(); i++) {
+            open[i].file.open(inputs[i], std::ios::binary);
+            if (!open[i].file) {
+                remove_runs();
+                ERR_EXIT(err_t::collect_file, "could not open run file \"%s\": %s", inputs[i].c_str(), std::strerror(errno))
+            }
+            char fmagic[4];
+            std::uint32_t fversion = 0;
+            if (!open[i].file.read(fmagic, sizeof(fmagic)) || std::memcmp(fmagic, magic, sizeof(magic)) != 0 || !read_pod(open[i].file, fversion) || fversion != version) {
+                remove_runs();
+                ERR_EXIT(err_t::collect_file, "run file \"%s\" is damaged", inputs[i].c_str())
+            }
+            advance(i);
+        }
+
+        std::optional<collected_t> last;
+        while (!heads.empty()) {
+            const std::size_t i = heads.top();
+            heads.pop();
+            if (!last || !(open[i].head == *last)) {
+                emit(open[i].head);
+                last = open[i].head;
+            }
+            advance(i);
+        }
+    }
+
+    /* merges the runs max_fan_in() at a time into new runs until one pass can take them all, then into filename, dropping
+     * repeats and the runs themselves; gives the count written
+     */
+    std::uint64_t merge(const std::string &filename) {
+        const std::size_t fan_in = max_fan_in();
+        std::vector<std::string> level = runs;
+        while (level.size() > fan_in) {
+            std::vector<std::string> merged;
+            for (std::size_t first = 0; first < level.size(); first += fan_in) {
+                const std::vector<std::string> group(level.begin() + first, level.begin() + std::min(first + fan_in, level.size()));
+                std::string name;
+                std::ofstream file = create_run(name);
+                merge_runs(group, [&](const collected_t &item) { write_item(file, item); });
+                close_run(file, name);
+                for (const std::string &run : group) {
+                    std::filesystem::remove(run);
+                    runs.erase(std::find(runs.begin(), runs.end(), run));
+                }
+                merged.push_back(name);
+            }
+            level = std::move(merged);
+        }
+
+        std::ofstream out(filename, std::ios::trunc);
+        if (!out) {
+            remove_runs();
+            ERR_EXIT(err_t::collect_file, "could not write \"%s\"", filename.c_str())
+        }
+        std::uint64_t written = 0;
+        merge_runs(level, [&](const collected_t &item) {
+            /* one that doesn't decode is left out, like in merge_partials */
+            if (sptrexpr_t a = decode_expr(item.expr, constants, unit)) {
+                out << item.err.toString(digits_prec) << '\t' << a->disp() << '\n';
+                written++;
+            }
+        });
+        out.close();
+        if (!out) {
+            remove_runs();
+            ERR_EXIT(err_t::collect_file, "could not write \"%s\": %s", filename.c_str(), std::strerror(errno))
+        }
+
+        remove_runs();
+        return written;
+    }
+};
+
+std::unique_ptr<collector_t> collector;
+
+/* percent done, rate and eta on stderr while the seeds are searched, off with --quiet
+ * workers only ever store to their own slot, the reporter thread adds everything up
+ */
+bool quiet = false;
+
+struct progress_t {
+    static constexpr double report_every = 1; /* seconds */
+
+    struct alignas(64) slot_t {
+        std::atomic_uint64_t evaluated = 0; /* in the seed being searched */
+    };
+
+    std::uint32_t seeds; /* in this shard */
+    /* candidates under one seed, a guess from the branching factor until a seed has been finished */
+    double estimate;
+    std::atomic_uint32_t seeds_done = 0;
+    std::atomic_uint64_t done_evaluated = 0; /* in finished seeds */
+    std::unique_ptr<slot_t[]> slots;
+    std::int32_t slot_count;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+    bool done = false;
+    std::thread reporter;
+
+    progress_t(std::uint32_t seeds, std::int32_t thread_count) : seeds(seeds), slots(std::make_unique<slot_t[]>(thread_count)), slot_count(thread_count) {
+        /* roughly the children test_expr is called on per node, dimensionless */
+        const double branching = 6.0 * constants.size() + 4.0 * std::max(max_int_constants - 1, 0) + 4.0 * std::max(max_int_constants, 0) + 1;
+        estimate = 0;
+        for (std::int32_t size = 0; size < max_expr_size; size++) {
+            estimate = estimate * branching + 1;
+        }
+    }
+
+    void finish_seed(std::int32_t slot) {
+        done_evaluated += slots[slot].evaluated.exchange(0, std::memory_order_relaxed);
+        seeds_done++;
+    }
+
+    void start_reporter() {
+        reporter = std::thread([this]() {
+            const bool tty = isatty(STDERR_FILENO);
+            bool printed = false;
+            std::unique_lock lock(done_mutex);
+            while (!done_cv.wait_for(lock, std::chrono::duration<double>(report_every), [this]() { return done; })) {
+                report(tty);
+                printed = true;
+            }
+            if (printed && tty) {
+                std::fprintf(stderr, "\r\33[K");
+            }
+        });
+    }
+
+    void finish() {
+        if (!reporter.joinable()) { return; }
+        {
+            std::lock_guard lock(done_mutex);
+            done = true;
+        }
+        done_cv.notify_one();
+        reporter.join();
+    }
+
+    void report(bool tty) {
+        const std::uint32_t finished = seeds_done.load(std::memory_order_relaxed);
+        const std::uint64_t finished_evaluated = done_evaluated.load(std::memory_order_relaxed);
+        const double per_seed = finished > 0 ? static_cast<double>(finished_evaluated) / finished : estimate;
+        double fraction = finished;
+        std::uint64_t evaluated = finished_evaluated;
+        for (std::int32_t i = 0; i < slot_count; i++) {
+            const std::uint64_t current = slots[i].evaluated.load(std::memory_order_relaxed);
+            evaluated += current;
+            fraction += std::min(0.99, current / per_seed); /* a seed only counts as done once it is */
+        }
+        fraction = seeds > 0 ? std::min(1.0, fraction / seeds) : 1;
+
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::string eta = "?";
+        if (fraction > 0) {
+            const auto remaining = static_cast<std::uint64_t>(elapsed * (1 - fraction) / fraction);
+            char buf[32];
+            std::snprintf(buf, sizeof buf, "%" PRIu64 ":%02" PRIu64 ":%02" PRIu64, remaining / 3600, remaining / 60 % 60, remaining % 60);
+            eta = buf;
+        }
+        std::fprintf(stderr, "%s%5.1f%%  %" PRIu64 " candidates  %.0f/s  eta %s%s", tty ? "\r\33[K" : "",
+                     fraction * 100, evaluated, evaluated / elapsed, eta.c_str(), tty ? "" : "\n");
+        std::fflush(stderr);
+    }
+};
+
+/* one search thread: its evaluation context and where its results currently go */
+struct worker_t {
+    static constexpr std::uint64_t flush_every = 4096;
+    static constexpr std::uint64_t clock_every = 64; /* candidates can take milliseconds each at high precision */
+
+    eval_ctx_t ctx;
+    bool report; /* a single interactive target, so --stream and the error thresholds apply */
+    std::vector<topk_t> *found = nullptr; /* one per target, in the same order as ctx.targets */
+    std::vector<std::pair<mpreal, std::string>> *table = nullptr; /* if set, every result goes here by value instead, encoded */
+    /* nothing further than this from a target can make it into that target's final results:
+     * the largest k-th error over the targets in found, or in a bucket this worker already finished
+     */
+    std::optional<mpreal> bound, carried_bound;
+    std::optional<double> score_bound, carried_score_bound; /* the same by score, with --complexity, instead */
+    /* the least the error part of a score can come to for any of the targets: a value under half a target's is off by
+     * more than that, and anything else can't get under the precision relative to it
+     */
+    double score_floor = std::numeric_limits<double>::infinity();
+    std::uint64_t evaluated = 0; /* not yet added to candidates_evaluated */
+    std::optional<mpreal> stop_error; /* the larger of max_error and max_rel_error * |target| */
+    std::uint32_t seed = 0; /* being searched */
+    progress_t::slot_t *progress = nullptr; /* this worker's slot, if progress is being reported */
+    std::vector<collected_t> collected; /* for --collect, not yet spilled */
+    std::size_t collected_bytes = 0;
+    std::unordered_map<std::string, std::uint32_t> expanded; /* for --prune-equivalent, smallest size each simplified form was expanded at, this seed */
+    std::vector<sptrexpr_t> *beam = nullptr; /* for --engine beam, every candidate tested also goes here */
+
+    explicit worker_t(mpfr_prec_t prec, mpfr_rnd_t rnd, const std::vector<dimreal_t> &targets, bool report) : ctx(prec, rnd, constants, targets), report(report) {
+        for (const dimreal_t &target : ctx.targets) {
+            score_floor = std::min(score_floor, log10_of(target.value) - std::log10(2.0) - digits_prec);
+        }
+        if (!report) { return; }
+        if (max_error) {
+            stop_error = *max_error;
+        }
+        if (max_rel_error) {
+            mpreal rel = *max_rel_error * mpfr::abs(ctx.targets.front().value);
+            if (!stop_error || rel > *stop_error) {
+                stop_error = rel;
+            }
+        }
+        if (stop_error) {
+            ctx.round(*stop_error);
+        }
+    }
+
+    ~worker_t() {
+        if (collector) {
+            collector->spill(collected);
+        }
+        candidates_evaluated += evaluated;
+        flush_stats();
+    }
+
+    void count() {
+        evaluated++;
+        if (max_candidates != 0 && candidates_evaluated.load(std::memory_order_relaxed) + evaluated >= max_candidates) {
+            request_stop("candidate limit reached");
+        }
+        if (evaluated % clock_every == 0) {
+            if (time_budget > 0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - search_start).count() >= time_budget) {
+                request_stop("time budget exhausted");
+            }
+            if (progress) {
+                progress->evaluated.fetch_add(clock_every, std::memory_order_relaxed);
+            }
+        }
+        if (evaluated == flush_every) {
+            candidates_evaluated += evaluated;
+            evaluated = 0;
+        }
+    }
+
+    /* switches to a new set of result lists, keeping the bound of the last one if it's tighter */
+    void collect_into(std::vector<topk_t> &results) {
+        if (bound && (!carried_bound || *bound < *carried_bound)) {
+            carried_bound = bound;
+        }
+        if (score_bound && (!carried_score_bound || *score_bound < *carried_score_bound)) {
+            carried_score_bound = score_bound;
+        }
+        found = &results;
+        update_bound();
+    }
+
+    void update_bound() {
+        if (complexity_weight > 0) {
+            update_score_bound();
+            return;
+        }
+        std::optional<mpreal> current;
+        for (const topk_t &results : *found) {
+            if (!results.full()) {
+                current.reset();
+                break;
+            }
+            if (!current || results.worst() > *current) {
+                current = results.worst();
+            }
+        }
+        if (current && carried_bound && *carried_bound < *current) {
+            current = carried_bound;
+        }
+        bound = current ? current : carried_bound;
+    }
+
+    void update_score_bound() {
+        std::optional<double> current;
+        for (const topk_t &results : *found) {
+            if (!results.full()) {
+                current.reset();
+                break;
+            }
+            if (!current || results.items.back().score > *current) {
+                current = results.items.back().score;
+            }
+        }
+        if (current && carried_score_bound && *carried_score_bound < *current) {
+            current = carried_score_bound;
+        }
+        score_bound = current ? current : carried_score_bound;
+    }
+
+    /* whether nothing at this size or larger can score well enough to be kept for any target */
+    bool level_out_of_reach(std::uint32_t size) const {
+        return score_bound && score_floor + complexity_weight * size > *score_bound;
+    }
+
+    /* checks a result against the targets around its value, walking outward from where it would sort in
+     * until the targets are further away than anything that could still be kept
+     */
+    void offer(const mpreal &value, const sptrexpr_t &a) {
+        if (table) {
+            if (encodable(a, ctx.unit())) {
+                table->emplace_back(value, encode_expr(a, ctx.constants, ctx.unit()));
+            }
+            return;
+        }
+        const std::vector<dimreal_t> &targets = ctx.targets;
+        const std::size_t split = std::lower_bound(targets.begin(), targets.end(), value, [](const dimreal_t &target, const mpreal &v) { return target.value < v; }) - targets.begin();
+        for (std::size_t i = split; i < targets.size() && offer_to(i, value, a); i++) {}
+        for (std::size_t i = split; i > 0 && offer_to(i - 1, value, a); i--) {}
+    }
+
+    bool offer_to(std::size_t i, const mpreal &value, const sptrexpr_t &a) {
+        const mpreal &diff = ctx.cost(value, ctx.targets[i].value);
+        if (report && collector && diff <= *collect_error && encodable(a, ctx.unit())) {
+            collected.push_back(collected_t{diff, encode_expr(a, ctx.constants, ctx.unit())});
+            collected_bytes += collected.back().bytes();
+            if (collected_bytes + collected.capacity() * sizeof(collected_t) >= collector->worker_memory) {
+                collector->spill(collected);
+                collected_bytes = 0;
+            }
+        }
+        if (bound && diff > *bound) {
+            count_stat(stat_t::pruned);
+            return false;
+        }
+        if (score_bound && std::max(log10_of(diff), score_floor) + complexity_weight * a->size() > *score_bound) {
+            count_stat(stat_t::pruned);
+            return false;
+        }
+        topk_t &results = (*found)[i];
+        if (results.offer(diff, a, seed) && results.full()) {
+            update_bound();
+        }
+        if (report) {
+            if (stream) {
+                stream->offer(diff, a, candidates_evaluated.load(std::memory_order_relaxed) + evaluated);
+            }
+            if (stop_error && diff <= *stop_error) {
+                request_stop("error threshold reached");
+            }
+        }
+        return true;
+    }
+};
+
+void recurse(worker_t&, sptrexpr_t, std::uint32_t);
+
+void test_expr(worker_t &w, const sptrexpr_t& a, std::uint32_t cursize) {
+    if (stop_search.load(std::memory_order_relaxed)) { return; }
+    const dimreal_t &res = a->load();
+    w.count();
+    if (!mpfr::isfinite(res.value)) { return; } /* exp and gamma overflow, nothing useful is built on it */
+    if (res.unit.same_dimension(w.ctx.unit())) {
+        w.offer(res.value, a);
+    } else {
+        count_stat(stat_t::dimension_rejects);
+    }
+    if (w.beam) {
+        w.beam->push_back(a);
+    }
+    /* everything under an expression that simplifies to one this seed already expanded, at that size or less, has
+     * been tried
+     * keyed on the rewrite stage alone, saturating an e-graph for every node expanded costs far more than it saves
+     */
+    if (prune_equivalent && cursize < static_cast<std::uint32_t>(max_expr_size)) {
+        auto [it, inserted] = w.expanded.try_emplace(rewrite(a)->disp(), cursize);
+        if (!inserted) {
+            if (it->second <= cursize) {
+                count_stat(stat_t::equivalent);
+                return;
+            }
+            it->second = cursize;
+        }
+    }
+    recurse(w, a, cursize + 1);
+}
+
+
+void recurse(worker_t &w, sptrexpr_t b, std::uint32_t cursize = 1) {
+    if (cursize > max_expr_size || stop_search.load(std::memory_order_relaxed)) { return; }
+    /* every expression built here is b with an operator and a leaf, or a function, on top */
+    if (w.level_out_of_reach(b->size() + (functions.empty() ? 2 : 1))) {
+        count_stat(stat_t::pruned);
+        return;
+    }
+    for (const cnst_t &constant : w.ctx.constants) {
+        /* don't technically need to include constant - b or constant / b, 
+         * it's covered by the 0 - and 1 / cases in the next recursion
+         * however, we're not guaranteed another recursion due to limits on expr size
+         * so we do them here anyway
+         */
+        if (b->load().unit.same_dimension(quantity())) {
+            if (constant.value.unit.same_dimension(quantity())) {
+                if (constant.value.value > 0 || (constant.value.value < 0 && mpfr::isint(b->load().value))) {
+                    test_expr(w, std::make_shared<powexpr_t>(std::make_shared<cnstexpr_t>(constant), b), cursize);
+                }
+                if (b->load().value > 0 || (b->load().value < 0 && mpfr::isint(constant.value.value))) {
+                    test_expr(w, std::make_shared<powexpr_t>(b, std::make_shared<cnstexpr_t>(constant)), cursize);
+                }
+                if (mpfr::isint(constant.value.value)) {
+                    test_expr(w, std::make_shared<powexpr_t>(b, std::make_shared<cnstexpr_t>(constant)), cursize);
+                }
+            }
+            if (mpfr::isint(b->load().value)) {
+                test_expr(w, std::make_shared<powexpr_t>(std::make_shared<cnstexpr_t>(constant), b), cursize);
+            }
+        }
+        test_expr(w, std::make_shared<mulexpr_t>(b, std::make_shared<cnstexpr_t>(constant)), cursize);
+        if (constant.value.value != 0) {
+            test_expr(w, std::make_shared<divexpr_t>(b, std::make_shared<cnstexpr_t>(constant)), cursize);
+        }
+        if (b->load().value != 0) {
+            test_expr(w, std::make_shared<divexpr_t>(std::make_shared<cnstexpr_t>(constant), b), cursize);
+        }
+        if (constant.value.unit.same_dimension(b->load().unit)) {
+            test_expr(w, std::make_shared<addexpr_t>(b, std::make_shared<cnstexpr_t>(constant)), cursize);
+            test_expr(w, std::make_shared<subexpr_t>(b, std::make_shared<cnstexpr_t>(constant)), cursize);
+            test_expr(w, std::make_shared<subexpr_t>(std::make_shared<cnstexpr_t>(constant), b), cursize);
+        }
+    }
+
+    for (mpreal i = 2; i <= max_int_constants; i++) {
+        test_expr(w, std::make_shared<mulexpr_t>(b, std::make_shared<litexpr_t>(dimreal_t{i, w.ctx.unit() / b->load().unit})), cursize);
+        sptrexpr_t bottom = std::make_shared<litexpr_t>(dimreal_t{i, b->load().unit / w.ctx.unit()});
+        if (bottom->load().value != 0) {
+            test_expr(w, std::make_shared<divexpr_t>(b, bottom), cursize);
+        }
+        if (b->load().unit.same_dimension(quantity())) {
+            if (mpfr::isint(b->load().value)) {
+                test_expr(w, std::make_shared<powexpr_t>(std::make_shared<litexpr_t>(dimreal_t{i}), b), cursize);
+            }
+            test_expr(w, std::make_shared<powexpr_t>(b, std::make_shared<litexpr_t>(dimreal_t{i})), cursize);
+        }
+    }
+
+    for (mpreal i = 1; i <= max_int_constants; i++) {
+        if (b->load().value != 0) {
+            test_expr(w, std::make_shared<divexpr_t>(std::make_shared<litexpr_t>(dimreal_t{i, b->load().unit * w.ctx.unit()}), b), cursize);
+        }
+        test_expr(w, std::make_shared<addexpr_t>(b, std::make_shared<litexpr_t>(dimreal_t{i, b->load().unit})), cursize);
+        test_expr(w, std::make_shared<subexpr_t>(b, std::make_shared<litexpr_t>(dimreal_t{i, b->load().unit})), cursize);
+        test_expr(w, std::make_shared<subexpr_t>(std::make_shared<litexpr_t>(dimreal_t{i, b->load().unit}), b), cursize);
+    }
+    test_expr(w, std::make_shared<subexpr_t>(std::make_shared<litexpr_t>(dimreal_t{0, b->load().unit}), b), cursize);
+
+    /* not straight back through the inverse, exp(ln(x)) and ln(exp(x)) are just x */
+    if (b->load().unit.same_dimension(quantity())) {
+        const func_t inner = b->type == etype_t::unexpr ? std::dynamic_pointer_cast<unexpr_t>(b)->func : func_t::count;
+        for (func_t f : functions) {
+            if ((f == func_t::exp && inner == func_t::ln) || (f == func_t::ln && inner == func_t::exp)) { continue; }
+            if (in_domain(f, b->load().value)) {
+                test_expr(w, std::make_shared<unexpr_t>(b, f), cursize);
+            }
+        }
+    }
+}
+
+
+/* this process only searches the seeds equal to shard_index mod shard_count */
+std::uint32_t shard_index = 0, shard_count = 1;
+
+std::uint32_t seed_count() {
+    return constants.size() + std::max(max_int_constants, 0);
+}
+
+/* the top level seeds are the constants then the integers, handed out to thread_count workers one at a time
+ * start is called with the worker and seed index before each seed is searched
+ */
+void for_each_seed(const std::vector<dimreal_t> &targets, std::int32_t thread_count, bool report, const std::function<void (worker_t&, std::uint32_t)> &start) {
+    const std::uint32_t count = seed_count();
+    std::atomic_uint32_t next_seed = 0;
+    const mpfr_prec_t prec = mpreal::get_default_prec();
+    const mpfr_rnd_t rnd = mpreal::get_default_rnd();
+    func_table.prepare(constants, max_int_constants);
+
+    std::optional<progress_t> progress;
+    if (!quiet) {
+        progress.emplace((count + shard_count - 1 - shard_index) / shard_count, thread_count);
+        progress->start_reporter();
+    }
+
+    auto work = [&](std::int32_t slot) {
+        worker_t w(prec, rnd, targets, report);
+        if (progress) {
+            w.progress = &progress->slots[slot];
+        }
+        for (std::uint32_t seed; !stop_search && (seed = next_seed++) < count;) {
+            if (seed % shard_count != shard_index) { continue; }
+            w.seed = seed;
+            w.expanded.clear();
+            start(w, seed);
+            if (seed < w.ctx.constants.size()) {
+                test_expr(w, std::make_shared<cnstexpr_t>(w.ctx.constants[seed]), 1);
+            } else {
+                test_expr(w, std::make_shared<litexpr_t>(dimreal_t{seed - w.ctx.constants.size() + 1, w.ctx.unit()}), 1);
+            }
+            if (progress) {
+                progress->finish_seed(slot);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (std::int32_t i = 1; i < thread_count; i++) {
+        threads.emplace_back(work, i);
+    }
+    work(0);
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    if (progress) {
+        progress->finish();
+    }
+}
+
+/* runs one enumeration pass for targets of a single dimension, giving the best results for each target in the order given */
+std::vector<topk_t> search(const std::vector<dimreal_t> &targets, std::int32_t thread_count, bool report) {
+    std::vector<std::size_t> order(targets.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return targets[a].value < targets[b].value; });
+    std::vector<dimreal_t> sorted;
+    sorted.reserve(targets.size());
+    for (std::size_t i : order) {
+        sorted.push_back(targets[i]);
+    }
+
+    /* each seed's results go in their own buckets, so the merged order doesn't depend on thread timing */
+    std::vector<std::vector<topk_t>> seed_results(seed_count(), std::vector<topk_t>(targets.size()));
+    {
+        phase_timer_t timer(phase_t::enumeration);
+        for_each_seed(sorted, thread_count, report, [&](worker_t &w, std::uint32_t seed) {
+            w.collect_into(seed_results[seed]);
+        });
+    }
+
+    phase_timer_t timer(phase_t::merge);
+    std::vector<topk_t> results(targets.size());
+    for (const std::vector<topk_t> &found : seed_results) {
+        for (std::size_t i = 0; i < order.size(); i++) {
+            results[order[i]].merge(found[i]);
+        }
+    }
+    return results;
+}
+
+bool deepen = false;
+
+/* --deepen: searches up to size 1, then 2, and so on to the max size, handing the results to publish after every size
+ * but the last, so short answers come out right away and a --time-budget or --max-candidates stop still has everything
+ * from the sizes that finished
+ * each size searches the smaller ones again, which costs little next to the largest
+ */
+std::vector<topk_t> deepening_search(const std::vector<dimreal_t> &targets, std::int32_t thread_count, bool report, const std::function<void (std::int32_t, const std::vector<topk_t>&)> &publish) {
+    const std::int32_t max_size = max_expr_size;
+    std::vector<topk_t> results(targets.size());
+    for (std::int32_t size = 1; size <= max_size && !stop_search; size++) {
+        max_expr_size = size;
+        const std::vector<topk_t> level = search(targets, thread_count, report);
+        for (std::size_t i = 0; i < results.size(); i++) {
+            results[i].merge(level[i]);
+        }
+        if (size < max_size && !stop_search) {
+            publish(size, results);
+        }
+    }
+    max_expr_size = max_size;
+    return results;
+}
+
+/* --engine pslq: looks for an integer relation between the target and the constants instead of enumerating,
+ * a0 t + a1 c1 + ... + an cn + d = 0 for sums, and the same over logarithms (with small primes) for products of powers
+ * PSLQ (Ferguson, Bailey and Arno) at the working precision, it either finds the smallest relation in a polynomial
+ * number of steps or proves there is none with coefficients under max_coeff
+ */
+enum struct engine_t : std::uint32_t {
+    enumerate, pslq, monomial, beam, gp,
+};
+
+static constexpr const char *ENGINE_NAMES[] = {
+    "enumerate", "pslq", "monomial", "beam", "gp",
+};
+
+engine_t engine = engine_t::enumerate;
+std::uint32_t max_coeff = 1000;
+bool prepass = true;
+
+/* the coefficients of a relation between x, each < max_coeff, holding to within tol relative to the size of x */
+std::optional<std::vector<mpreal>> pslq(const std::vector<mpreal> &x, const mpreal &tol, const mpreal &max_coeff, std::uint32_t max_steps) {
+    const std::size_t n = x.size();
+    if (n < 2) { return std::nullopt; }
+    for (const mpreal &xk : x) {
+        if (mpfr::abs(xk) < tol) { return std::nullopt; }
+    }
+
+    const mpreal g = mpfr::sqrt(mpreal(4) / 3);
+    std::vector<mpreal> s(n), y(x);
+    for (std::size_t k = 0; k < n; k++) {
+        mpreal t = 0;
+        for (std::size_t j = k; j < n; j++) {
+            t += x[j] * x[j];
         }
+        s[k] = mpfr::sqrt(t);
+    }
+    const mpreal norm = s[0];
+    for (std::size_t k = 0; k < n; k++) {
+        y[k] /= norm;
+        s[k] /= norm;
     }
 
-    for (mpreal i = 2; i <= max_int_constants; i++) {
-        test_expr(std::make_shared<mulexpr_t>(b, std::make_shared<litexpr_t>(dimreal_t{i, target->unit / b->load().unit})), cursize);
-        sptrexpr_t bottom = std::make_shared<litexpr_t>(dimreal_t{i, b->load().unit / target->unit});
-        if (bottom->load().value != 0) {
-            test_expr(std::make_shared<divexpr_t>(b, bottom), cursize);
+    std::vector<std::vector<mpreal>> h(n, std::vector<mpreal>(n, mpreal(0))), b(n, std::vector<mpreal>(n, mpreal(0)));
+    for (std::size_t i = 0; i < n; i++) {
+        b[i][i] = 1;
+        if (i + 1 < n && s[i] != 0) {
+            h[i][i] = s[i + 1] / s[i];
         }
-        if (b->load().unit.same_dimension(quantity())) {
-            if (mpfr::isint(b->load().value)) {
-                test_expr(std::make_shared<powexpr_t>(std::make_shared<litexpr_t>(dimreal_t{i}), b), cursize);
+        for (std::size_t j = 0; j < i; j++) {
+            const mpreal sjj = s[j] * s[j + 1];
+            if (sjj != 0) {
+                h[i][j] = -y[i] * y[j] / sjj;
+            }
+        }
+    }
+
+    /* hermite reduction of row i against rows last..0 */
+    auto reduce = [&](std::size_t i, std::size_t last) -> bool {
+        for (std::size_t j = last + 1; j-- > 0;) {
+            if (h[j][j] == 0) { return false; }
+            const mpreal t = mpfr::round(h[i][j] / h[j][j]);
+            if (t == 0) { continue; }
+            y[j] += t * y[i];
+            for (std::size_t k = 0; k <= j; k++) {
+                h[i][k] -= t * h[j][k];
+            }
+            for (std::size_t k = 0; k < n; k++) {
+                b[k][j] += t * b[k][i];
+            }
+        }
+        return true;
+    };
+    for (std::size_t i = 1; i < n; i++) {
+        reduce(i, i - 1);
+    }
+
+    for (std::uint32_t step = 0; step < max_steps; step++) {
+        std::size_t m = 0;
+        mpreal best = -1, gi = 1;
+        for (std::size_t i = 0; i + 1 < n; i++) {
+            gi *= g;
+            const mpreal size = gi * mpfr::abs(h[i][i]);
+            if (size > best) {
+                best = size;
+                m = i;
+            }
+        }
+        std::swap(y[m], y[m + 1]);
+        std::swap(h[m], h[m + 1]);
+        for (std::size_t i = 0; i < n; i++) {
+            std::swap(b[i][m], b[i][m + 1]);
+        }
+        if (m + 2 < n) {
+            const mpreal t0 = mpfr::sqrt(h[m][m] * h[m][m] + h[m][m + 1] * h[m][m + 1]);
+            if (t0 == 0) { return std::nullopt; }
+            const mpreal t1 = h[m][m] / t0, t2 = h[m][m + 1] / t0;
+            for (std::size_t i = m; i < n; i++) {
+                const mpreal t3 = h[i][m], t4 = h[i][m + 1];
+                h[i][m] = t1 * t3 + t2 * t4;
+                h[i][m + 1] = -t2 * t3 + t1 * t4;
+            }
+        }
+        for (std::size_t i = m + 1; i < n; i++) {
+            if (!reduce(i, std::min(i - 1, m + 1))) { break; }
+        }
+
+        for (std::size_t i = 0; i < n; i++) {
+            if (mpfr::abs(y[i]) >= tol) { continue; }
+            std::vector<mpreal> relation(n);
+            bool small = true;
+            for (std::size_t j = 0; j < n; j++) {
+                relation[j] = mpfr::round(b[j][i]);
+                small = small && mpfr::abs(relation[j]) < max_coeff;
+            }
+            if (small) { return relation; }
+        }
+
+        /* no relation can have coefficients smaller than 1 / max |h| */
+        mpreal largest = 0;
+        for (const std::vector<mpreal> &row : h) {
+            for (const mpreal &v : row) {
+                largest = mpfr::fmax(largest, mpfr::abs(v));
+            }
+        }
+        if (largest != 0 && 1 / largest >= max_coeff) { return std::nullopt; }
+    }
+    return std::nullopt;
+}
+
+/* with d digits, some relation with about d digits of coefficients in total always exists, and PSLQ turns up
+ * chance ones well under that, so only relations using at most half the digits count
+ */
+bool significant(const std::vector<mpreal> &relation, std::int32_t digits) {
+    double total = 0;
+    for (const mpreal &coeff : relation) {
+        total += std::log10(std::max(1.0, std::fabs(coeff.toDouble())));
+    }
+    return total <= digits / 2.0;
+}
+
+/* how many significant digits the target was given to, a relation doesn't have to hold any closer than that */
+std::int32_t given_digits(const mpreal &x) {
+    for (std::int32_t n = 1; n < digits_prec; n++) {
+        if (mpreal(x.toString(n)) == x) { return n; }
+    }
+    return digits_prec;
+}
+
+sptrexpr_t make_literal(long n, const quantity &unit) {
+    return std::make_shared<litexpr_t>(dimreal_t{mpreal(n), unit});
+}
+
+/* sum of coefficient * term, written as differences where coefficients are negative */
+sptrexpr_t make_sum(const std::vector<std::pair<long, sptrexpr_t>> &terms, const quantity &unit) {
+    sptrexpr_t sum;
+    for (const auto &[coeff, term] : terms) {
+        sptrexpr_t scaled = std::labs(coeff) == 1 ? term : std::make_shared<mulexpr_t>(make_literal(std::labs(coeff), quantity()), term);
+        if (!sum) {
+            sum = coeff > 0 ? scaled : std::make_shared<subexpr_t>(make_literal(0, unit), scaled);
+        } else if (coeff > 0) {
+            sum = std::make_shared<addexpr_t>(sum, scaled);
+        } else {
+            sum = std::make_shared<subexpr_t>(sum, scaled);
+        }
+    }
+    return sum ? sum : make_literal(0, unit);
+}
+
+/* product of base ^ exponent, negative exponents go in the denominator */
+sptrexpr_t make_product(const std::vector<std::pair<long, sptrexpr_t>> &factors) {
+    sptrexpr_t num, den;
+    for (const auto &[exponent, base] : factors) {
+        sptrexpr_t power = std::labs(exponent) == 1 ? base : std::make_shared<powexpr_t>(base, make_literal(std::labs(exponent), quantity()));
+        sptrexpr_t &side = exponent > 0 ? num : den;
+        side = side ? std::make_shared<mulexpr_t>(side, power) : power;
+    }
+    if (!num) {
+        num = make_literal(1, quantity());
+    }
+    return den ? std::make_shared<divexpr_t>(num, den) : num;
+}
+
+/* the linear and the multiplicative relation for one target, as results like the enumeration's */
+topk_t relation_search(const dimreal_t &target) {
+    topk_t results;
+    const std::int32_t digits = given_digits(target.value);
+    const mpreal tol = mpfr::pow(mpreal(10), 1 - digits);
+    const std::uint32_t max_steps = 10000;
+
+    auto offer = [&](const sptrexpr_t &a) {
+        const dimreal_t &value = a->load();
+        if (value.unit.same_dimension(target.unit)) {
+            results.offer(cost(value.value, target.value), a, 0);
+        }
+    };
+
+    /* a0 t + sum ai ci + d = 0, over the constants of the target's dimension */
+    std::vector<const cnst_t*> linear;
+    std::vector<mpreal> x{target.value};
+    for (const cnst_t &constant : constants) {
+        if (constant.value.unit.same_dimension(target.unit) && constant.value.value != 0) {
+            linear.push_back(&constant);
+            x.push_back(constant.value.value);
+        }
+    }
+    x.emplace_back(1);
+    if (std::optional<std::vector<mpreal>> relation = pslq(x, tol, max_coeff, max_steps); relation && (*relation)[0] != 0 && significant(*relation, digits)) {
+        const long a0 = (*relation)[0].toLong(), sign = a0 > 0 ? -1 : 1;
+        std::vector<std::pair<long, sptrexpr_t>> terms;
+        for (std::size_t i = 0; i < linear.size(); i++) {
+            if (const long ai = (*relation)[i + 1].toLong(); ai != 0) {
+                terms.emplace_back(sign * ai, std::make_shared<cnstexpr_t>(*linear[i]));
+            }
+        }
+        if (const long d = relation->back().toLong(); d != 0) {
+            terms.emplace_back(sign * d > 0 ? 1 : -1, make_literal(std::labs(d), target.unit));
+        }
+        sptrexpr_t sum = make_sum(terms, target.unit);
+        offer(std::labs(a0) == 1 ? sum : std::make_shared<divexpr_t>(sum, make_literal(std::labs(a0), quantity())));
+    }
+
+    /* a0 log|t| + sum ai log ci + sum bj log pj = 0, over the positive constants and primes up to max_int_constants */
+    if (target.value == 0) { return results; }
+    std::vector<sptrexpr_t> bases;
+    std::vector<mpreal> logs{mpfr::log(mpfr::abs(target.value))};
+    for (const cnst_t &constant : constants) {
+        if (constant.value.value > 0 && constant.value.value != 1) {
+            bases.push_back(std::make_shared<cnstexpr_t>(constant));
+            logs.push_back(mpfr::log(constant.value.value));
+        }
+    }
+    for (long p = 2; p <= std::max(max_int_constants, 3); p++) {
+        bool prime = true;
+        for (long q = 2; q * q <= p; q++) {
+            prime = prime && p % q != 0;
+        }
+        if (prime) {
+            bases.push_back(make_literal(p, quantity()));
+            logs.push_back(mpfr::log(mpreal(p)));
+        }
+    }
+    if (std::optional<std::vector<mpreal>> relation = pslq(logs, tol, max_coeff, max_steps); relation && (*relation)[0] != 0 && significant(*relation, digits)) {
+        const long a0 = (*relation)[0].toLong(), sign = a0 > 0 ? -1 : 1;
+        std::optional<quantity> dimension = phys::units::nth_power(target.unit, static_cast<int>(a0)); /* re-emplaced, like expr_t::cache */
+        std::vector<std::pair<long, sptrexpr_t>> factors;
+        for (std::size_t i = 0; i < bases.size(); i++) {
+            if (const long ai = (*relation)[i + 1].toLong(); ai != 0) {
+                factors.emplace_back(sign * ai, bases[i]);
+                dimension.emplace(*dimension * phys::units::nth_power(bases[i]->load().unit, static_cast<int>(ai)));
+            }
+        }
+        /* the logs only see the numbers, so a relation between quantities has to have its dimensions cancel too */
+        const bool scalar = target.unit.same_dimension(quantity());
+        if (dimension->same_dimension(quantity()) && (std::labs(a0) == 1 || scalar)) {
+            sptrexpr_t product = make_product(factors);
+            if (std::labs(a0) != 1) {
+                product = std::make_shared<powexpr_t>(product, std::make_shared<divexpr_t>(make_literal(1, quantity()), make_literal(std::labs(a0), quantity())));
+            }
+            offer(target.value < 0 ? std::make_shared<subexpr_t>(make_literal(0, target.unit), product) : product);
+        }
+    }
+    return results;
+}
+
+/* the continued fraction pre-pass, microseconds next to the enumeration
+ * the expansion of target / c for every constant c, and of the target itself, gives p / q * c from its first close
+ * convergent, and a quadratic irrational (a + k sqrt(d)) / e * c when the terms turn periodic
+ */
+std::vector<mpreal> continued_fraction(mpreal x, std::int32_t digits) {
+    std::vector<mpreal> terms;
+    const mpreal limit = mpfr::pow(mpreal(10), digits);
+    mpreal q = 1, q_prev = 0;
+    while (terms.size() < 64) {
+        const mpreal a = mpfr::floor(x);
+        /* a convergent with q^2 past 10^digits is fitting the digits rather than the value */
+        if (const mpreal q_next = a * q + q_prev; !terms.empty() && q_next * q_next > limit) { break; }
+        std::tie(q, q_prev) = std::make_pair(a * q + q_prev, q);
+        terms.push_back(a);
+        x -= a;
+        if (x * limit < 1) { break; }
+        x = 1 / x;
+    }
+    return terms;
+}
+
+sptrexpr_t make_fraction(sptrexpr_t num, long den) {
+    return den == 1 ? num : std::make_shared<divexpr_t>(std::move(num), make_literal(den, quantity()));
+}
+
+/* p / q * constant, or p / q in the target's unit without one */
+sptrexpr_t make_rational(long p, long q, const cnst_t *constant, const quantity &unit) {
+    sptrexpr_t num;
+    if (!constant) {
+        num = make_literal(std::labs(p), unit);
+    } else if (const quantity lunit = unit / constant->value.unit; std::labs(p) == 1 && lunit.same_dimension(quantity())) {
+        num = std::make_shared<cnstexpr_t>(*constant);
+    } else {
+        num = std::make_shared<mulexpr_t>(make_literal(std::labs(p), lunit), std::make_shared<cnstexpr_t>(*constant));
+    }
+    num = make_fraction(num, q);
+    return p < 0 ? std::make_shared<subexpr_t>(make_literal(0, unit), num) : num;
+}
+
+/* x = [a0; ..., a(s-1), periodic b1, ..., bm] solves a x^2 + b x + c = 0, written out as (-b +- k sqrt(d)) / 2a */
+sptrexpr_t make_quadratic(const std::vector<mpreal> &terms, std::size_t s, std::size_t m, const mpreal &x, std::int32_t digits) {
+    /* y = [b1; ..., bm, y] = (P y + P') / (Q y + Q'), so Q y^2 + (Q' - P) y - P' = 0 */
+    mpreal p = 1, p_prev = 0, q = 0, q_prev = 1;
+    for (std::size_t i = s; i < s + m; i++) {
+        std::tie(p, p_prev) = std::make_pair(terms[i] * p + p_prev, p);
+        std::tie(q, q_prev) = std::make_pair(terms[i] * q + q_prev, q);
+    }
+    const mpreal yq = q, yr = q_prev - p, ys = -p_prev;
+    /* x = (alpha y + beta) / (gamma y + delta) through the terms before the period, substituted back for y */
+    mpreal alpha = 1, beta = 0, gamma = 0, delta = 1;
+    for (std::size_t i = 0; i < s; i++) {
+        std::tie(alpha, beta) = std::make_pair(terms[i] * alpha + beta, alpha);
+        std::tie(gamma, delta) = std::make_pair(terms[i] * gamma + delta, gamma);
+    }
+    mpreal a = yq * delta * delta - yr * delta * gamma + ys * gamma * gamma;
+    mpreal b = -2 * yq * beta * delta + yr * (beta * gamma + alpha * delta) - 2 * ys * alpha * gamma;
+    mpreal c = yq * beta * beta - yr * alpha * beta + ys * alpha * alpha;
+    if (a < 0) {
+        a = -a, b = -b, c = -c;
+    }
+    const mpreal disc = b * b - 4 * a * c;
+    const mpreal limit = mpfr::pow(mpreal(2), 40);
+    if (a == 0 || disc <= 0 || a > limit || mpfr::abs(b) > limit || disc > limit || !significant({a, b, c}, digits)) { return nullptr; }
+
+    /* disc = k^2 d with d squarefree */
+    long d = disc.toLong(), k = 1;
+    for (long f = 2; f * f <= d; f++) {
+        while (d % (f * f) == 0) {
+            d /= f * f;
+            k *= f;
+        }
+    }
+    if (d == 1) { return nullptr; } /* rational after all, the convergents have it */
+    long num = -b.toLong(), den = 2 * a.toLong();
+    const long g = std::gcd(std::gcd(num, k), den);
+    num /= g, k /= g, den /= g;
+    const bool plus = x * den > num;
+
+    sptrexpr_t root = std::make_shared<powexpr_t>(make_literal(d, quantity()), std::make_shared<divexpr_t>(make_literal(1, quantity()), make_literal(2, quantity())));
+    if (k != 1) {
+        root = std::make_shared<mulexpr_t>(make_literal(k, quantity()), root);
+    }
+    sptrexpr_t sum;
+    if (num == 0) {
+        sum = plus ? root : std::make_shared<subexpr_t>(make_literal(0, quantity()), root);
+    } else if (num > 0) {
+        sum = plus ? sptrexpr_t(std::make_shared<addexpr_t>(make_literal(num, quantity()), root)) : std::make_shared<subexpr_t>(make_literal(num, quantity()), root);
+    } else if (plus) {
+        sum = std::make_shared<subexpr_t>(root, make_literal(-num, quantity()));
+    } else {
+        sum = std::make_shared<subexpr_t>(make_literal(0, quantity()), std::make_shared<addexpr_t>(make_literal(-num, quantity()), root));
+    }
+    return make_fraction(sum, den);
+}
+
+topk_t continued_fraction_search(const dimreal_t &target) {
+    topk_t results;
+    const std::int32_t digits = given_digits(target.value);
+    const mpreal tol = mpfr::pow(mpreal(10), 1 - digits);
+    const std::size_t max_period = 8;
+
+    /* seeded after every enumeration seed, so when the enumeration finds the same value its result is the one kept */
+    auto offer = [&](const sptrexpr_t &a) {
+        if (const mpreal err = cost(a->load().value, target.value); err <= tol * mpfr::abs(target.value)) {
+            results.offer(err, a, std::numeric_limits<std::uint32_t>::max());
+        }
+    };
+
+    std::vector<const cnst_t*> divisors{nullptr};
+    for (const cnst_t &constant : constants) {
+        if (constant.value.value != 0) {
+            divisors.push_back(&constant);
+        }
+    }
+    for (const cnst_t *constant : divisors) {
+        const mpreal x = constant ? target.value / constant->value.value : target.value;
+        const std::vector<mpreal> terms = continued_fraction(x, digits);
+
+        /* the first convergent within tol, when it's small next to the digits it has to explain */
+        mpreal p = 1, p_prev = 0, q = 0, q_prev = 1;
+        for (const mpreal &term : terms) {
+            std::tie(p, p_prev) = std::make_pair(term * p + p_prev, p);
+            std::tie(q, q_prev) = std::make_pair(term * q + q_prev, q);
+            if (mpfr::abs(x - p / q) <= tol * mpfr::abs(x)) {
+                if (significant({p, q}, digits)) {
+                    offer(make_rational(p.toLong(), q.toLong(), constant, target.unit));
+                }
+                break;
+            }
+        }
+
+        /* the shortest period repeating at least twice through to the end and over at least half the terms, leaving out
+         * the last term which only approximates the rest of the value, and only for ratios without a dimension
+         */
+        const quantity unit = constant ? constant->value.unit : quantity();
+        if (!unit.same_dimension(target.unit) || terms.size() < 4) { continue; }
+        const std::size_t n = terms.size() - 1;
+        bool found = false;
+        for (std::size_t s = 0; !found && s + 2 < n; s++) {
+            for (std::size_t m = 1; !found && m <= max_period && s + 2 * m <= n && 2 * s <= n; m++) {
+                bool periodic = true;
+                for (std::size_t i = s + m; periodic && i < n; i++) {
+                    periodic = terms[i] == terms[i - m];
+                }
+                if (!periodic) { continue; }
+                found = true;
+                if (sptrexpr_t quadratic = make_quadratic(terms, s, m, x, digits)) {
+                    offer(constant ? std::make_shared<mulexpr_t>(quadratic, std::make_shared<cnstexpr_t>(*constant)) : quadratic);
+                }
+            }
+        }
+    }
+    return results;
+}
+
+/* --engine monomial: products of powers of the constants and small primes, pi^2 e / 3 and the like, met in the middle
+ * in log space instead of going through recurse's nested mul, div and pow
+ * every monomial of weight (sum of |exponents|) up to the max size goes in an array for its dimension sorted by
+ * log |value| in doubles, each one's other half is a binary search for log |target| - log |value| in the array of the
+ * dimension that makes up the target's, and only those hits are checked at full precision
+ */
+struct monomial_t {
+    double log;
+    double err; /* bound on how far log is from the exact log |value| */
+    std::vector<std::int8_t> exponents; /* one per base */
+};
+
+struct monomial_index_t {
+    std::vector<sptrexpr_t> bases;
+    std::vector<double> logs, errs;
+    std::vector<phys::units::dimensions> dims;
+    std::map<phys::units::dimensions, std::vector<monomial_t>> items; /* by dimension */
+
+    /* the same bases as the multiplicative relation of --engine pslq */
+    explicit monomial_index_t(std::int32_t max_weight) {
+        for (const cnst_t &constant : constants) {
+            if (constant.value.value > 0 && constant.value.value != 1) {
+                bases.push_back(std::make_shared<cnstexpr_t>(constant));
+            }
+        }
+        for (long p = 2; p <= std::max(max_int_constants, 3); p++) {
+            bool prime = true;
+            for (long q = 2; q * q <= p; q++) {
+                prime = prime && p % q != 0;
+            }
+            if (prime) {
+                bases.push_back(make_literal(p, quantity()));
+            }
+        }
+        for (const sptrexpr_t &base : bases) {
+            logs.push_back(mpfr::log(base->load().value).toDouble());
+            errs.push_back(std::numeric_limits<double>::epsilon() * (std::fabs(logs.back()) + 1));
+            dims.push_back(base->load().unit.dimension());
+        }
+        std::vector<std::int8_t> exponents(bases.size());
+        add(exponents, 0, std::min(max_weight, 127), 0, 0, phys::units::dimensions());
+        for (auto &[dim, list] : items) {
+            std::sort(list.begin(), list.end(), [](const monomial_t &a, const monomial_t &b) { return a.log < b.log; });
+        }
+    }
+
+    void add(std::vector<std::int8_t> &exponents, std::size_t i, std::int32_t weight, double log, double err, const phys::units::dimensions &dim) {
+        if (i == bases.size()) {
+            items[dim].push_back(monomial_t{log, err + std::numeric_limits<double>::epsilon() * std::fabs(log), exponents});
+            return;
+        }
+        for (std::int32_t e = -weight; e <= weight; e++) {
+            exponents[i] = static_cast<std::int8_t>(e);
+            add(exponents, i + 1, weight - std::abs(e), log + e * logs[i], err + std::abs(e) * errs[i], phys::units::product(dim, phys::units::power(dims[i], e)));
+        }
+        exponents[i] = 0;
+    }
+
+    /* the nearest other half on each side, along with anything the doubles can't tell apart from it */
+    topk_t search(const dimreal_t &target) const {
+        topk_t results;
+        if (target.value == 0) { return results; }
+        const double log_target = mpfr::log(mpfr::abs(target.value)).toDouble();
+        std::uint64_t evaluated = 0;
+
+        auto check = [&](const monomial_t &a, const monomial_t &b) {
+            evaluated++;
+            std::vector<std::pair<long, sptrexpr_t>> factors;
+            for (std::size_t i = 0; i < bases.size(); i++) {
+                if (const long e = a.exponents[i] + b.exponents[i]; e != 0) {
+                    factors.emplace_back(e, bases[i]);
+                }
+            }
+            sptrexpr_t product = make_product(factors);
+            const dimreal_t &value = product->load();
+            if (!value.unit.same_dimension(target.unit)) {
+                count_stat(stat_t::dimension_rejects);
+                return;
+            }
+            if (target.value < 0) {
+                product = std::make_shared<subexpr_t>(make_literal(0, target.unit), product);
+            }
+            results.offer(cost(product->load().value, target.value), product, 0);
+        };
+
+        auto by_log = [](const monomial_t &item, double log) { return item.log < log; };
+        for (const auto &[dim, list] : items) {
+            const auto other = items.find(phys::units::quotient(target.unit.dimension(), dim));
+            if (other == items.end()) { continue; }
+            const std::vector<monomial_t> &halves = other->second;
+            for (const monomial_t &a : list) {
+                const double wanted = log_target - a.log;
+                const auto pos = std::lower_bound(halves.begin(), halves.end(), wanted, by_log);
+                if (pos != halves.end()) {
+                    for (auto it = pos; it != halves.end() && it->log - it->err <= pos->log + pos->err; ++it) {
+                        check(a, *it);
+                    }
+                }
+                if (pos != halves.begin()) {
+                    const auto below = std::prev(pos);
+                    for (auto it = below; it->log + it->err >= below->log - below->err; --it) {
+                        check(a, *it);
+                        if (it == halves.begin()) { break; }
+                    }
+                }
+            }
+        }
+        candidates_evaluated += evaluated;
+        return results;
+    }
+};
+
+/* --engine beam: sizes far past what enumerating everything can reach, by only extending the beam_width most promising
+ * expressions of each size by the same one step recurse takes, giving up on finding everything
+ * an expression is promising when one more step could land it on the target, so it's scored by how close (relatively)
+ * it is to the nearest subtarget: the value that would give the target when combined with a constant or integer
+ */
+std::uint32_t beam_width = 1000;
+
+struct subtargets_t {
+    std::vector<double> positive, negative; /* log |subtarget|, sorted, by sign */
+
+    explicit subtargets_t(const dimreal_t &target) {
+        const double t = target.value.toDouble();
+        std::vector<double> operands;
+        for (const cnst_t &constant : constants) {
+            operands.push_back(constant.value.value.toDouble());
+        }
+        for (std::int32_t i = 1; i <= max_int_constants; i++) {
+            operands.push_back(i);
+        }
+        add(t);
+        for (double x : operands) {
+            add(t - x);
+            add(t + x);
+            add(x - t);
+            if (x != 0) {
+                add(t / x);
+                add(t * x);
+                add(x / t);
+                add(std::pow(t, 1 / x));
+            }
+            if (x > 0 && x != 1 && t > 0) {
+                add(std::log(t) / std::log(x));
+            }
+        }
+        std::sort(positive.begin(), positive.end());
+        std::sort(negative.begin(), negative.end());
+    }
+
+    void add(double v) {
+        if (v == 0 || !std::isfinite(v)) { return; }
+        (v > 0 ? positive : negative).push_back(std::log(std::fabs(v)));
+    }
+
+    /* |log |v| - log |s|| for the nearest subtarget s of the same sign */
+    double score(double v) const {
+        const std::vector<double> &logs = v > 0 ? positive : negative;
+        if (v == 0 || !std::isfinite(v) || logs.empty()) { return std::numeric_limits<double>::infinity(); }
+        const double l = std::log(std::fabs(v));
+        const auto pos = std::lower_bound(logs.begin(), logs.end(), l);
+        double best = std::numeric_limits<double>::infinity();
+        if (pos != logs.end()) {
+            best = *pos - l;
+        }
+        if (pos != logs.begin()) {
+            best = std::min(best, l - *std::prev(pos));
+        }
+        return best;
+    }
+};
+
+topk_t beam_search(const dimreal_t &target, std::int32_t thread_count, bool report) {
+    const std::int32_t max_size = max_expr_size;
+    const subtargets_t subtargets(target);
+    const mpfr_prec_t prec = mpreal::get_default_prec();
+    const mpfr_rnd_t rnd = mpreal::get_default_rnd();
+    func_table.prepare(constants, max_int_constants);
+
+    /* each beam member's results and extensions go in their own buckets, like the seeds of search */
+    std::vector<std::vector<topk_t>> found;
+    std::vector<sptrexpr_t> beam;
+    std::uint32_t first_seed = 0;
+
+    for (std::int32_t size = 1; size <= max_size && !stop_search; size++) {
+        std::vector<sptrexpr_t> parents = size == 1 ? std::vector<sptrexpr_t>{nullptr} : std::move(beam);
+        std::vector<std::vector<sptrexpr_t>> children(parents.size());
+        found.resize(found.size() + parents.size(), std::vector<topk_t>(1));
+        max_expr_size = size; /* so recurse takes just the one step */
+
+        std::atomic_uint32_t next = 0;
+        auto work = [&] {
+            worker_t w(prec, rnd, {target}, report);
+            for (std::uint32_t i; !stop_search && (i = next++) < parents.size();) {
+                w.seed = first_seed + i;
+                w.collect_into(found[first_seed + i]);
+                w.beam = &children[i];
+                if (parents[i]) {
+                    recurse(w, parents[i], size);
+                    continue;
+                }
+                for (const cnst_t &constant : w.ctx.constants) {
+                    test_expr(w, std::make_shared<cnstexpr_t>(constant), 1);
+                }
+                for (std::int32_t n = 1; n <= max_int_constants; n++) {
+                    test_expr(w, std::make_shared<litexpr_t>(dimreal_t{n, w.ctx.unit()}), 1);
+                }
+            }
+        };
+        std::vector<std::thread> threads;
+        for (std::int32_t i = 1; i < thread_count; i++) {
+            threads.emplace_back(work);
+        }
+        work();
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+        first_seed += parents.size();
+
+        /* the next beam, best scores first and ties in the order they were made, without repeated values */
+        struct scored_t {
+            double score;
+            sptrexpr_t expr;
+        };
+        std::vector<scored_t> scored;
+        for (std::vector<sptrexpr_t> &list : children) {
+            for (sptrexpr_t &child : list) {
+                scored.push_back(scored_t{subtargets.score(child->load().value.toDouble()), std::move(child)});
+            }
+        }
+        std::stable_sort(scored.begin(), scored.end(), [](const scored_t &a, const scored_t &b) { return a.score < b.score; });
+        std::unordered_set<double> seen;
+        for (const scored_t &item : scored) {
+            if (beam.size() >= beam_width) { break; }
+            if (seen.insert(item.expr->load().value.toDouble()).second) {
+                beam.push_back(item.expr);
+            }
+        }
+        if (!quiet) {
+            std::cerr << "size " << size << ": " << scored.size() << " candidates, kept " << beam.size() << '\n';
+        }
+    }
+    max_expr_size = max_size;
+
+    topk_t results;
+    for (const std::vector<topk_t> &bucket : found) {
+        results.merge(bucket[0]);
+    }
+    return results;
+}
+
+/* --engine gp: open-ended search by evolving populations of expression trees, one island per thread
+ * an individual is scored by its relative error in digits plus size_penalty digits per node, children come from
+ * tournament winners by crossover (a subtree of one put in place of a subtree of the other) or mutation (a node swapped
+ * for another constant or operator, or a subtree for a new random one), and every migrate_every generations each island
+ * sends copies of its best to the next one around the ring
+ * every individual is dimensionally valid, anything else is thrown out before it's evaluated
+ */
+std::uint32_t population_size = 200, generations = 200, migrate_every = 10;
+double size_penalty = 0.25;
+std::uint64_t gp_seed = 1;
+
+/* loads a, unless that would fail one of dimreal_t's dimension checks (which exit) or leave a function's domain */
+bool well_formed(const sptrexpr_t &a) {
+    if (!a->dirty) { return mpfr::isfinite(a->load().value); }
+    if (a->type == etype_t::unexpr) {
+        if (!well_formed(a->exprs[0])) { return false; }
+        const dimreal_t &arg = a->exprs[0]->load();
+        if (!arg.unit.same_dimension(quantity()) || !in_domain(std::dynamic_pointer_cast<unexpr_t>(a)->func, arg.value)) { return false; }
+    } else if (a->exprs.size() == 2) {
+        if (!well_formed(a->exprs[0]) || !well_formed(a->exprs[1])) { return false; }
+        const dimreal_t &l = a->exprs[0]->load(), &r = a->exprs[1]->load();
+        switch (a->type) {
+            case etype_t::addexpr: case etype_t::subexpr:
+                if (!l.unit.same_dimension(r.unit)) { return false; }
+                break;
+            case etype_t::divexpr:
+                if (r.value == 0) { return false; }
+                break;
+            case etype_t::powexpr: {
+                const bool scalar_base = l.unit.same_dimension(quantity());
+                if (!r.unit.same_dimension(quantity()) || (l.value == 0 && r.value <= 0)) { return false; }
+                if (!mpfr::isint(r.value) && (!scalar_base || l.value < 0)) { return false; }
+                if (!scalar_base && mpfr::abs(r.value) > 8) { return false; }
+                break;
+            }
+            default: break;
+        }
+    }
+    return mpfr::isfinite(a->load().value);
+}
+
+/* the nth node in prefix order */
+sptrexpr_t subtree_at(const sptrexpr_t &a, std::uint32_t n) {
+    if (n == 0) { return a; }
+    n--;
+    for (const sptrexpr_t &expr : a->exprs) {
+        const std::uint32_t size = expr->size();
+        if (n < size) { return subtree_at(expr, n); }
+        n -= size;
+    }
+    return a;
+}
+
+sptrexpr_t with_children(const sptrexpr_t &a, const std::vector<sptrexpr_t> &children) {
+    if (a->type == etype_t::unexpr) {
+        return std::make_shared<unexpr_t>(children[0], std::dynamic_pointer_cast<unexpr_t>(a)->func);
+    }
+    return make_binary(a->type, children[0], children[1]);
+}
+
+/* a copy of the path down to the nth node with that node replaced, the rest is shared */
+sptrexpr_t replace_at(const sptrexpr_t &a, std::uint32_t n, const sptrexpr_t &replacement) {
+    if (n == 0) { return replacement; }
+    n--;
+    std::vector<sptrexpr_t> children = a->exprs;
+    for (sptrexpr_t &child : children) {
+        const std::uint32_t size = child->size();
+        if (n < size) {
+            child = replace_at(child, n, replacement);
+            return with_children(a, children);
+        }
+        n -= size;
+    }
+    return a;
+}
+
+struct island_t {
+    struct individual_t {
+        sptrexpr_t expr;
+        double score;
+    };
+
+    worker_t &w;
+    std::mt19937_64 rng;
+    std::vector<sptrexpr_t> terminals; /* the constants, integers, and integers in the target's unit */
+    std::uint32_t max_nodes;
+    double digits; /* the best score from error alone, for an exact match */
+    std::vector<individual_t> population;
+
+    island_t(worker_t &w, std::uint64_t seed) : w(w), rng(seed), max_nodes(2 * max_expr_size + 1) {
+        for (const cnst_t &constant : w.ctx.constants) {
+            terminals.push_back(std::make_shared<cnstexpr_t>(constant));
+        }
+        for (std::int32_t n = 1; n <= std::max(max_int_constants, 1); n++) {
+            terminals.push_back(make_literal(n, quantity()));
+            if (!w.ctx.unit().same_dimension(quantity())) {
+                terminals.push_back(make_literal(n, w.ctx.unit()));
+            }
+        }
+        digits = -static_cast<double>(digits_prec);
+    }
+
+    std::uint32_t pick(std::size_t n) {
+        return std::uniform_int_distribution<std::uint32_t>(0, static_cast<std::uint32_t>(n - 1))(rng);
+    }
+
+    bool chance(double p) {
+        return std::uniform_real_distribution<double>(0, 1)(rng) < p;
+    }
+
+    etype_t random_op() {
+        static constexpr etype_t ops[] = {etype_t::addexpr, etype_t::subexpr, etype_t::mulexpr, etype_t::divexpr, etype_t::powexpr};
+        return ops[pick(std::size(ops))];
+    }
+
+    sptrexpr_t random_tree(std::uint32_t depth) {
+        if (depth == 0 || chance(0.3)) {
+            return terminals[pick(terminals.size())];
+        }
+        if (!functions.empty() && chance(0.1)) {
+            return std::make_shared<unexpr_t>(random_tree(depth - 1), functions[pick(functions.size())]);
+        }
+        return make_binary(random_op(), random_tree(depth - 1), random_tree(depth - 1));
+    }
+
+    /* nullopt for anything without the target's dimension or too big */
+    std::optional<individual_t> evaluate(const sptrexpr_t &a) {
+        if (a->size() > max_nodes || !well_formed(a)) { return std::nullopt; }
+        const dimreal_t &value = a->load();
+        w.count();
+        if (!value.unit.same_dimension(w.ctx.unit())) {
+            count_stat(stat_t::dimension_rejects);
+            return std::nullopt;
+        }
+        w.offer(value.value, a);
+        const mpreal &target = w.ctx.targets.front().value;
+        mpreal rel = w.ctx.cost(value.value, target);
+        if (target != 0) {
+            rel /= mpfr::abs(target);
+        }
+        const double error = std::max(std::log10(std::max(rel.toDouble(), 1e-300)), digits);
+        return individual_t{a, error + size_penalty * a->size()};
+    }
+
+    sptrexpr_t mutate(const sptrexpr_t &a) {
+        const std::uint32_t n = pick(a->size());
+        const sptrexpr_t node = subtree_at(a, n);
+        if (chance(0.5)) {
+            return replace_at(a, n, random_tree(2));
+        }
+        if (node->exprs.empty()) {
+            return replace_at(a, n, terminals[pick(terminals.size())]);
+        }
+        if (node->type == etype_t::unexpr) {
+            return replace_at(a, n, std::make_shared<unexpr_t>(node->exprs[0], functions[pick(functions.size())]));
+        }
+        return replace_at(a, n, make_binary(random_op(), node->exprs[0], node->exprs[1]));
+    }
+
+    sptrexpr_t crossover(const sptrexpr_t &a, const sptrexpr_t &b) {
+        return replace_at(a, pick(a->size()), subtree_at(b, pick(b->size())));
+    }
+
+    const individual_t &tournament() {
+        const individual_t *best = &population[pick(population.size())];
+        for (std::uint32_t i = 1; i < 3; i++) {
+            const individual_t &other = population[pick(population.size())];
+            if (other.score < best->score) {
+                best = &other;
+            }
+        }
+        return *best;
+    }
+
+    void sort() {
+        std::stable_sort(population.begin(), population.end(), [](const individual_t &a, const individual_t &b) { return a.score < b.score; });
+    }
+
+    void initialize() {
+        for (std::uint32_t tries = 0; population.size() < population_size && tries < population_size * 100; tries++) {
+            if (std::optional<individual_t> individual = evaluate(random_tree(1 + tries % 3))) {
+                population.push_back(std::move(*individual));
+            }
+        }
+        if (population.empty()) {
+            population.push_back(*evaluate(make_literal(1, w.ctx.unit())));
+        }
+        sort();
+    }
+
+    /* the best two carry over unchanged, a child that isn't valid after a few tries is its parent again */
+    void generation() {
+        std::vector<individual_t> next(population.begin(), population.begin() + std::min<std::size_t>(2, population.size()));
+        while (next.size() < population_size && !stop_search.load(std::memory_order_relaxed)) {
+            const individual_t &parent = tournament();
+            std::optional<individual_t> child;
+            for (std::uint32_t tries = 0; !child && tries < 8; tries++) {
+                child = evaluate(chance(0.6) ? crossover(parent.expr, tournament().expr) : mutate(parent.expr));
+            }
+            next.push_back(child ? std::move(*child) : parent);
+        }
+        population = std::move(next);
+        sort();
+    }
+
+    void immigrate(const std::vector<individual_t> &migrants) {
+        for (std::size_t i = 0; i < migrants.size() && i < population.size(); i++) {
+            population[population.size() - 1 - i] = migrants[i];
+        }
+        sort();
+    }
+};
+
+topk_t gp_search(const dimreal_t &target, std::int32_t thread_count, bool report) {
+    const mpfr_prec_t prec = mpreal::get_default_prec();
+    const mpfr_rnd_t rnd = mpreal::get_default_rnd();
+    func_table.prepare(constants, max_int_constants);
+    const std::size_t migrants = 2;
+
+    std::vector<std::vector<topk_t>> found(thread_count, std::vector<topk_t>(1));
+    std::vector<std::vector<island_t::individual_t>> outbox(thread_count);
+    bool stopping = false, migrated = false;
+    std::uint32_t generation = 0;
+    /* runs once everyone's at the barrier, so the decision to stop is the same on every island
+     * the barrier is passed twice a migration, once with the outboxes full and once with them all read
+     */
+    std::barrier sync(thread_count, [&]() noexcept {
+        stopping = stop_search.load();
+        migrated = !migrated;
+        if (migrated && !quiet) {
+            double best = outbox[0].front().score;
+            for (const auto &box : outbox) {
+                best = std::min(best, box.front().score);
+            }
+            std::cerr << "generation " << generation << ": best score " << best << '\n';
+        }
+    });
+
+    auto work = [&](std::int32_t i) {
+        worker_t w(prec, rnd, {target}, report);
+        w.seed = i;
+        w.collect_into(found[i]);
+        island_t island(w, gp_seed + i);
+        island.initialize();
+        for (std::uint32_t g = 1; g <= generations; g++) {
+            island.generation();
+            if (g % migrate_every != 0 && g != generations) { continue; }
+            outbox[i].assign(island.population.begin(), island.population.begin() + std::min(migrants, island.population.size()));
+            if (i == 0) {
+                generation = g;
             }
-            test_expr(std::make_shared<powexpr_t>(b, std::make_shared<litexpr_t>(dimreal_t{i})), cursize);
+            sync.arrive_and_wait();
+            island.immigrate(outbox[(i + thread_count - 1) % thread_count]);
+            sync.arrive_and_wait();
+            if (stopping) { break; }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (std::int32_t i = 1; i < thread_count; i++) {
+        threads.emplace_back(work, i);
+    }
+    work(0);
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    topk_t results;
+    for (const std::vector<topk_t> &bucket : found) {
+        results.merge(bucket[0]);
+    }
+    return results;
+}
+
+/* every candidate of one configuration sorted by value, expressions kept encoded and only decoded for the results given out */
+struct table_t {
+    static constexpr const char magic[4] = {'E', 'X', 'T', 'B'};
+    static constexpr std::uint32_t version = 1;
+
+    mpfr_prec_t prec;
+    std::int32_t expr_size, int_constants;
+    quantity unit;
+    std::vector<cnst_t> cnsts;
+    std::vector<std::pair<mpreal, std::string>> entries;
+
+    static table_t build(const quantity &unit, std::int32_t thread_count) {
+        table_t table{mpreal::get_default_prec(), max_expr_size, max_int_constants, unit, constants, {}};
+        std::vector<std::vector<std::pair<mpreal, std::string>>> seed_entries(seed_count());
+        for_each_seed({dimreal_t{0, unit}}, thread_count, false, [&](worker_t &w, std::uint32_t seed) {
+            w.table = &seed_entries[seed];
+        });
+        for (auto &entries : seed_entries) {
+            table.entries.insert(table.entries.end(), std::make_move_iterator(entries.begin()), std::make_move_iterator(entries.end()));
         }
+        std::stable_sort(table.entries.begin(), table.entries.end(), [](const std::pair<mpreal, std::string> &a, const std::pair<mpreal, std::string> &b) { return a.first < b.first; });
+        return table;
     }
 
-    for (mpreal i = 1; i <= max_int_constants; i++) {
-        if (b->load().value != 0) {
-            test_expr(std::make_shared<divexpr_t>(std::make_shared<litexpr_t>(dimreal_t{i, b->load().unit * target->unit}), b), cursize);
+    /* where the table for the current configuration is kept between runs of the server */
+    static std::string filename(const quantity &unit) {
+        std::string key = std::to_string(mpreal::get_default_prec()) + ";" + std::to_string(max_expr_size) + ";" + std::to_string(max_int_constants) + ";" + phys::units::to_base_unit_symbols(unit);
+        for (const cnst_t &constant : constants) {
+            key += ";" + constant.name + "=" + constant.value.to_str();
         }
-        test_expr(std::make_shared<addexpr_t>(b, std::make_shared<litexpr_t>(dimreal_t{i, b->load().unit})), cursize);
-        test_expr(std::make_shared<subexpr_t>(b, std::make_shared<litexpr_t>(dimreal_t{i, b->load().unit})), cursize);
-        test_expr(std::make_shared<subexpr_t>(std::make_shared<litexpr_t>(dimreal_t{i, b->load().unit}), b), cursize);
+        for (func_t f : functions) {
+            key += std::string(";") + FUNC_NAMES[static_cast<std::size_t>(f)] + "()";
+        }
+        std::stringstream name;
+        name << SAVE_AST_DIR << "/table-" << std::hex << std::hash<std::string>{}(key) << ".bin";
+        return name.str();
     }
-    test_expr(std::make_shared<subexpr_t>(std::make_shared<litexpr_t>(dimreal_t{0, b->load().unit}), b), cursize);
-}
 
+    void store(const std::string &name) const {
+        std::ofstream file(name, std::ios::binary | std::ios::trunc);
+        file.write(magic, sizeof(magic));
+        write_pod(file, version);
+        write_pod(file, static_cast<std::int64_t>(prec));
+        write_pod(file, expr_size);
+        write_pod(file, int_constants);
+        write_unit(file, unit);
+        write_cnst_list(file, cnsts, prec);
+        write_pod(file, static_cast<std::uint64_t>(entries.size()));
+        for (const auto &[value, expr] : entries) {
+            write_raw(file, value, prec);
+            write_str(file, expr);
+        }
+    }
 
-int main(int argc, char **argv) {
-    std::int32_t thread_count = 1;
-
-    if (argc == 2) {
-        if (!std::strcmp(argv[1], "-v") || !std::strcmp(argv[1], "--version")) {
-            std::cout << "exactonator version " VERSION ", " YEAR " by .stole.\n";
-            return 0;
+    /* nullopt for a missing or damaged file, or one made with other constants */
+    static std::optional<table_t> load(const std::string &name) {
+        std::ifstream file(name, std::ios::binary);
+        char fmagic[4];
+        std::uint32_t fversion = 0;
+        std::int64_t fprec = 0;
+        std::uint64_t count = 0;
+        std::int32_t expr_size = 0, int_constants = 0;
+        if (!file.read(fmagic, sizeof(fmagic)) || std::memcmp(fmagic, magic, sizeof(magic)) != 0) { return std::nullopt; }
+        if (!read_pod(file, fversion) || fversion != version || !read_pod(file, fprec) || fprec != mpreal::get_default_prec()) { return std::nullopt; }
+        if (!read_pod(file, expr_size) || !read_pod(file, int_constants)) { return std::nullopt; }
+        std::optional<quantity> unit = read_unit(file);
+        if (!unit) { return std::nullopt; }
+        table_t table{mpreal::get_default_prec(), expr_size, int_constants, *unit, {}, {}};
+        if (!read_cnst_list(file, table.cnsts, table.prec) || table.cnsts.size() != constants.size() || !read_pod(file, count)) { return std::nullopt; }
+        for (std::size_t i = 0; i < constants.size(); i++) {
+            if (table.cnsts[i].name != constants[i].name || table.cnsts[i].value.value != constants[i].value.value) { return std::nullopt; }
+        }
+        table.entries.resize(count);
+        for (auto &[value, expr] : table.entries) {
+            if (!read_raw(file, table.prec, value) || !read_str(file, expr)) { return std::nullopt; }
         }
+        return table;
+    }
 
-        if (!std::strcmp(argv[1], "-h") || !std::strcmp(argv[1], "--help")) {
-            std::cout << "usage: " << argv[0] << R"( [flags]
+    bool matches(const quantity &other) const {
+        return prec == mpreal::get_default_prec() && expr_size == max_expr_size && int_constants == max_int_constants && unit.same_dimension(other);
+    }
 
-    -j <count> : runs <count> threads
-    -v, --version : displays texproj's version
-    -h, --help : displays this help
-)";
-            return 0;
-        }
-    } else if (argc > 2) {
-        for (std::uint32_t i = 1; i < argc - 1; i++) {
-            if (argv[i][0] != '-') {
-                std::cerr << "error: unexpected option \"" << argv[i] << "\"\n";
-                return 4;
+    /* walks outward from where the target sorts in, always taking the closer side, until nothing left can be kept */
+    topk_t nearest(const mpreal &target, std::size_t k) const {
+        topk_t results(k);
+        auto split = std::lower_bound(entries.begin(), entries.end(), target, [](const std::pair<mpreal, std::string> &entry, const mpreal &v) { return entry.first < v; });
+        auto hi = split, lo = split;
+        while (hi != entries.end() || lo != entries.begin()) {
+            const bool take_hi = lo == entries.begin() || (hi != entries.end() && hi->first - target <= target - (lo - 1)->first);
+            const auto &entry = take_hi ? *hi : *(lo - 1);
+            const mpreal diff = cost(entry.first, target);
+            if (results.out_of_reach(diff, target / 2, 1)) { break; }
+            if (sptrexpr_t a = decode_expr(entry.second, cnsts, unit)) {
+                results.offer(diff, a, 0);
             }
-            if (!std::strcmp(argv[i], "-j")) {
-                thread_count = std::strtol(argv[++i], nullptr, 0);
-                if (thread_count == 0) {
-                    ERR_EXIT(err_t::bad_thread_count, "bad thread count, must be an integer > 0")
-                }
+            if (take_hi) {
+                ++hi;
+            } else {
+                --lo;
             }
         }
+        return results;
     }
+};
 
-    if (!std::filesystem::exists(SAVE_AST_DIR)) {
-        if (!std::filesystem::create_directory(SAVE_AST_DIR)) {
-            ERR_EXIT(err_t::create_save_dir, "AST save directory \"%s\" does not exist, failed to create", SAVE_AST_DIR)
+/* every line is rendered into the same buffer */
+void render_results(const topk_t &results, std::string &out) {
+    for (const result_t &item : results.items) {
+        item.expr->render(out);
+        out += " | err: ";
+        out += item.err.toString(digits_prec);
+        if (complexity_weight > 0) {
+            char buf[32];
+            std::snprintf(buf, sizeof(buf), " | score: %.3f", item.score);
+            out += buf;
         }
+        out += '\n';
     }
+}
+
+void print_results(const topk_t &results) {
+    static std::string buf;
+    buf.clear();
+    render_results(results, buf);
+    std::cout << buf;
+}
 
-    std::cout << "digits: ";
-    std::string digits_prec_str;
-    std::getline(std::cin, digits_prec_str);
-    digits_prec = std::stoi(digits_prec_str);
-    mpreal::set_default_prec(static_cast<mpfr_prec_t>(std::pow(10, std::log2(digits_prec + 1))));
-
-    std::cout << "target: ";
-    std::string target_str;
-    std::getline(std::cin, target_str);
-    target = std::make_unique<dimreal_t>(dimreal_t::from_str(target_str));
-
-    std::cout << "max expr size: ";
-    std::string max_expr_size_str;
-    std::getline(std::cin, max_expr_size_str);
-    max_expr_size = std::stoi(max_expr_size_str);
-
-    std::cout << "integer constants up to: ";
-    std::string max_int_constants_str;
-    std::getline(std::cin, max_int_constants_str);
-    max_int_constants = std::stoi(max_int_constants_str);
-
-    const std::vector<cnst_t> default_constants = {
-        cnst_t{
-            dimreal_t{mpfr::const_pi()},
-            "pi", true
-        },
-        cnst_t{
-            dimreal_t{const_e_str},
-            "e", true
-        },
-        cnst_t{
-            dimreal_t{mpfr::const_euler()},
-            "euler", true
-        },
-        cnst_t{
-            dimreal_t{mpfr::const_log2()},
-            "ln2", true
-        },
-        cnst_t{
-            dimreal_t{mpfr::const_catalan()},
-            "catalan", true
-        },
-        cnst_t{
-            dimreal_t{("1" + mpfr::sqrt("5")) / "2"},
-            "phi", true
-        },
-        cnst_t{
-            dimreal_t{"0.0072973525693"},
-            "fine-structure", true
+/* one target per line, "[name =] value [unit]", blank lines and lines starting with '#' are skipped */
+std::vector<std::pair<std::string, dimreal_t>> read_batch(const std::string &filename) {
+    std::ifstream file(filename);
+    if (!file) {
+        ERR_EXIT(err_t::open_batch_file, "could not open batch file \"%s\"", filename.c_str())
+    }
+    std::vector<std::pair<std::string, dimreal_t>> targets;
+    std::uint32_t lineno = 0;
+    for (std::string line; std::getline(file, line);) {
+        lineno++;
+        line.erase(0, line.find_first_not_of(" \t"));
+        if (line.empty() || line[0] == '#') { continue; }
+        std::string name = std::to_string(lineno), value = line;
+        const std::size_t eq = line.find('=');
+        if (eq != std::string::npos) {
+            name = line.substr(0, eq);
+            name.erase(name.find_last_not_of(" \t") + 1);
+            value = line.substr(eq + 1);
+            value.erase(0, value.find_first_not_of(" \t"));
         }
-    };
+        targets.emplace_back(name, dimreal_t::from_str(value));
+    }
+    if (targets.empty()) {
+        ERR_EXIT(err_t::open_batch_file, "batch file \"%s\" has no targets", filename.c_str())
+    }
+    return targets;
+}
 
+/* reads constants.conf at the current default precision, values come from the constant cache where possible */
+std::vector<cnst_t> read_constants() {
+    cnst_cache_t cnst_cache(mpreal::get_default_prec());
+    cnst_cache.load();
+
+    std::vector<cnst_t> loaded;
     std::ifstream constants_file(CONSTANTS_FILENAME);
     std::uint32_t ocount = 0;
     for (std::string line; std::getline(constants_file, line);) {
@@ -615,9 +3739,9 @@ int main(int argc, char **argv) {
         split(line, "=", opts);
 
         if (opts.size() == 1) {
-            auto pos = std::find_if(default_constants.begin(), default_constants.end(), [&](const cnst_t &constant) -> bool { return constant.name == opts[0]; });
+            auto pos = std::find_if(default_constants.begin(), default_constants.end(), [&](const default_cnst_t &constant) -> bool { return constant.name == opts[0]; });
             if (pos != default_constants.end()) {
-                constants.push_back(*pos);
+                loaded.push_back(cnst_t{dimreal_t{cnst_cache.get(pos->name, pos->compute)}, pos->name, true});
                 continue;
             }
             std::cout << "warning: " << CONSTANTS_FILENAME << " file #" << ocount << " config option had 1 token; expecting default constant name, but \"" << opts[0] << "\" is not of {";
@@ -640,21 +3764,648 @@ int main(int argc, char **argv) {
             std::cout << "warning: " << CONSTANTS_FILENAME << " file #" << ocount << " config option had empty name or value ... skipping\n";
             continue;
         }
-        for (std::uint32_t i = 0; i < constants.size(); i++) {
-            if (constants[i].name == name) {
-                ERR_EXIT(err_t::redef_constant, "\"%s\" file #%i config option redefined: %s = %s over previous #%i config option %s = %s\n", CONSTANTS_FILENAME, ocount, name.c_str(), dimreal_t::from_str(value).to_str().c_str(), i + 1, constants[i].name.c_str(), constants[i].value.to_str().c_str())
+        for (std::uint32_t i = 0; i < loaded.size(); i++) {
+            if (loaded[i].name == name) {
+                ERR_EXIT(err_t::redef_constant, "\"%s\" file #%i config option redefined: %s = %s over previous #%i config option %s = %s\n", CONSTANTS_FILENAME, ocount, name.c_str(), dimreal_t::from_str(value).to_str().c_str(), i + 1, loaded[i].name.c_str(), loaded[i].value.to_str().c_str())
             }
         }
         for (std::uint32_t i = 0; i < default_constants.size(); i++) {
             if (default_constants[i].name == name) {
-                ERR_EXIT(err_t::redef_default_constant, "\"%s\" file #%i config option redefined default constant: %s = %s over %s = %s\n", CONSTANTS_FILENAME, ocount, name.c_str(), dimreal_t::from_str(value).to_str().c_str(), default_constants[i].name.c_str(), constants[i].value.to_str().c_str())
+                ERR_EXIT(err_t::redef_default_constant, "\"%s\" file #%i config option redefined default constant: %s = %s over %s = %s\n", CONSTANTS_FILENAME, ocount, name.c_str(), dimreal_t::from_str(value).to_str().c_str(), default_constants[i].name.c_str(), dimreal_t{default_constants[i].compute()}.to_str().c_str())
             }
         }
         /* std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); }); */
 
-        cnst_t tcnst = cnst_t{.value = dimreal_t::from_str(value), .name = name};
+        cnst_t tcnst = cnst_t{.value = dimreal_t::from_str(value, cnst_cache.get("%" + value, [&] { return mpreal(value); })), .name = name};
+
+        loaded.push_back(tcnst);
+    }
+
+    cnst_cache.store();
+    return loaded;
+}
+
+/* answers queries over a unix socket, a line "<digits> <max size> <max int> <value> [unit]" each,
+ * with "ok <count>" followed by that many result lines, or "error <message>"
+ * constants and candidate tables are built the first time a configuration is asked for and then stay resident,
+ * tables are also written to save/ so the next server with the same constants starts with them
+ */
+struct server_t {
+    std::int32_t thread_count;
+    std::unordered_map<mpfr_prec_t, std::vector<cnst_t>> constants_by_prec;
+    std::vector<std::unique_ptr<table_t>> tables;
+
+    std::string answer(const std::string &line) {
+        std::istringstream query(line);
+        std::int32_t digits = 0, size = 0, ints = 0;
+        std::string value;
+        if (!(query >> digits >> size >> ints) || !std::getline(query >> std::ws, value) || value.empty()) {
+            return "error expected \"<digits> <max size> <max int> <value> [unit]\"\n";
+        }
+        if (digits <= 0 || size <= 0 || ints < 0) {
+            return "error digits and max size must be > 0, max int >= 0\n";
+        }
+
+        digits_prec = digits;
+        max_expr_size = size;
+        max_int_constants = ints;
+        mpreal::set_default_prec(digits_to_prec(digits));
+        auto pos = constants_by_prec.find(mpreal::get_default_prec());
+        if (pos == constants_by_prec.end()) {
+            pos = constants_by_prec.emplace(mpreal::get_default_prec(), read_constants()).first;
+        }
+        constants = pos->second;
+
+        /* a bad unit is that client's problem, the server keeps going for everyone else */
+        std::optional<dimreal_t> query_target;
+        decltype(tables)::iterator table;
+        try {
+            query_target.emplace(dimreal_t::parse(value, mpreal(value)));
+            table = std::find_if(tables.begin(), tables.end(), [&](const std::unique_ptr<table_t> &t) { return t->matches(query_target->unit); });
+            if (table == tables.end()) {
+                const std::string filename = table_t::filename(query_target->unit);
+                std::optional<table_t> stored = table_t::load(filename);
+                if (!stored) {
+                    /* a table cut short would be missing candidates for every query after, so it's never kept */
+                    search_start = std::chrono::steady_clock::now();
+                    stop_search = false;
+                    stored = table_t::build(query_target->unit, thread_count);
+                    if (stop_search) {
+                        stop_search = false;
+                        return std::string("error table build stopped: ") + stop_reason + "\n";
+                    }
+                    stored->store(filename);
+                }
+                tables.push_back(std::make_unique<table_t>(std::move(*stored)));
+                table = tables.end() - 1;
+            }
+        } catch (const std::exception &e) {
+            std::string message = e.what();
+            std::replace(message.begin(), message.end(), '\n', ' ');
+            return "error " + message + "\n";
+        }
+
+        const topk_t results = (*table)->nearest(query_target->value, result_count);
+        std::string response = "ok " + std::to_string(results.items.size()) + "\n";
+        render_results(results, response);
+        return response;
+    }
+
+    void serve(const std::string &path) {
+        quiet = true; /* nobody is watching stderr for any one query */
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (fd < 0 || path.size() >= sizeof(addr.sun_path)) {
+            ERR_EXIT(err_t::socket, "could not create socket \"%s\"", path.c_str())
+        }
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        /* a socket left behind by an earlier server is replaced, anything else at the path is left alone */
+        struct stat existing{};
+        if (::lstat(path.c_str(), &existing) == 0) {
+            if (!S_ISSOCK(existing.st_mode)) {
+                ERR_EXIT(err_t::socket, "\"%s\" exists and is not a socket", path.c_str())
+            }
+            ::unlink(path.c_str());
+        }
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(fd, 16) < 0) {
+            ERR_EXIT(err_t::socket, "could not listen on socket \"%s\": %s", path.c_str(), std::strerror(errno))
+        }
+        std::cerr << "listening on " << path << '\n';
+
+        while (true) {
+            const int client = ::accept(fd, nullptr, nullptr);
+            if (client < 0) { continue; }
+            std::string pending;
+            char buf[4096];
+            for (ssize_t n; (n = ::read(client, buf, sizeof(buf))) > 0;) {
+                pending.append(buf, n);
+                for (std::size_t end; (end = pending.find('\n')) != std::string::npos;) {
+                    std::string line = pending.substr(0, end);
+                    pending.erase(0, end + 1);
+                    if (!line.empty() && line.back() == '\r') { line.pop_back(); }
+                    const std::string response = answer(line);
+                    for (std::size_t sent = 0; sent < response.size();) {
+                        const ssize_t m = ::send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+                        if (m <= 0) { break; }
+                        sent += m;
+                    }
+                }
+            }
+            ::close(client);
+        }
+    }
+};
+
+/* everything a shard's results depend on past the seed string: the precision, every option that changes what's found
+ * or how it's ranked, and the targets, so only shards of the exact same search share a partial's config and filename
+ */
+std::string partial_config(const std::string &seed_str, const std::vector<std::pair<std::string, dimreal_t>> &targets) {
+    std::ostringstream config;
+    config << seed_str << ";digits=" << digits_prec << ",prec=" << mpreal::get_default_prec() << ",top=" << result_count
+           << ",engine=" << ENGINE_NAMES[static_cast<std::uint32_t>(engine)] << ",functions=";
+    for (func_t f : functions) {
+        config << FUNC_NAMES[static_cast<std::uint8_t>(f)] << ' ';
+    }
+    config << ",complexity=" << complexity_weight << ",egraph=" << use_egraph << ",prepass=" << prepass << ",max_coeff=" << max_coeff
+           << ",beam_width=" << beam_width << ",gp=" << population_size << '/' << generations << '/' << migrate_every << '/' << size_penalty << '/' << gp_seed
+           << ";targets=";
+    for (const auto &[name, value] : targets) {
+        config << name << '=' << value.to_str() << ',';
+    }
+    return config.str();
+}
+
+/* a shard's results, as a results file with its shard set
+ * errors are kept exactly so ties can be broken the same way as in one pass
+ */
+void write_partial(const std::string &filename, const std::string &config, const std::vector<std::pair<std::string, dimreal_t>> &targets, const std::vector<topk_t> &results) {
+    results_file_t file{mpreal::get_default_prec(), digits_prec, config, shard_index, shard_count, constants, {}};
+    for (std::size_t i = 0; i < targets.size(); i++) {
+        file.add(targets[i].first, targets[i].second, results[i]);
+    }
+    file.write(filename);
+}
+
+/* "merge" subcommand, combines the partial files of the shards of one search into its final results */
+int merge_partials(const std::vector<std::string> &filenames) {
+    std::optional<results_file_t> merged;
+    std::vector<bool> seen_shards;
+
+    for (const std::string &filename : filenames) {
+        std::optional<results_file_t> partial = results_file_t::read(filename);
+        if (!partial) {
+            ERR_EXIT(err_t::bad_partial, "\"%s\" is not a partial result file", filename.c_str())
+        }
+        if (merged && (partial->prec != merged->prec || partial->digits != merged->digits)) {
+            ERR_EXIT(err_t::bad_partial, "\"%s\" was searched at %i digits (precision %li), expected %i digits (precision %li)", filename.c_str(), partial->digits, static_cast<long>(partial->prec), merged->digits, static_cast<long>(merged->prec))
+        }
+        if (merged && partial->config != merged->config) {
+            ERR_EXIT(err_t::bad_partial, "\"%s\" is from a different search: %s, expected %s", filename.c_str(), partial->config.c_str(), merged->config.c_str())
+        }
+        if ((merged && partial->shard_count != merged->shard_count) || partial->shard_index >= partial->shard_count) {
+            ERR_EXIT(err_t::bad_partial, "\"%s\" is shard %u of %u, expected shards of %u", filename.c_str(), partial->shard_index, partial->shard_count, merged ? merged->shard_count : partial->shard_count)
+        }
+        seen_shards.resize(partial->shard_count);
+        if (seen_shards[partial->shard_index]) {
+            ERR_EXIT(err_t::bad_partial, "\"%s\" repeats shard %u", filename.c_str(), partial->shard_index)
+        }
+        seen_shards[partial->shard_index] = true;
+
+        if (!merged) {
+            merged = std::move(partial);
+            continue;
+        }
+        for (results_file_t::target_t &target : partial->targets) {
+            auto pos = std::find_if(merged->targets.begin(), merged->targets.end(), [&](const results_file_t::target_t &t) { return t.name == target.name; });
+            if (pos == merged->targets.end()) {
+                merged->targets.push_back(std::move(target));
+            } else if (pos->value.value != target.value.value || !pos->value.unit.same_dimension(target.value.unit)) {
+                ERR_EXIT(err_t::bad_partial, "\"%s\" has target \"%s\" = %s, expected %s", filename.c_str(), target.name.c_str(), target.value.to_str().c_str(), pos->value.to_str().c_str())
+            } else {
+                pos->results.insert(pos->results.end(), std::make_move_iterator(target.results.begin()), std::make_move_iterator(target.results.end()));
+            }
+        }
+    }
+
+    for (std::uint32_t i = 0; i < seen_shards.size(); i++) {
+        if (!seen_shards[i]) {
+            std::cerr << "warning: shard " << i << " of " << seen_shards.size() << " is missing, results are incomplete\n";
+        }
+    }
+
+    /* ranked by topk_t like one whole run, so results equal across shards are merged the same way too */
+    digits_prec = merged->digits;
+    for (const results_file_t::target_t &target : merged->targets) {
+        topk_t results;
+        for (const results_file_t::entry_t &entry : target.results) {
+            if (sptrexpr_t a = merged->decode(target, entry)) {
+                results.offer(entry.err, a, entry.seed, entry.size, entry.length);
+            }
+        }
+        if (merged->targets.size() > 1) {
+            std::cout << "== " << target.name << " = " << target.value.to_str() << '\n';
+        }
+        print_results(results);
+    }
+    return 0;
+}
+
+/* --stats and --stats-json, main's own counts are flushed first so setup work shows up too */
+void print_stats_json(std::FILE *out) {
+    flush_stats();
+    std::fprintf(out, "\"candidates\": %" PRIu64 ", \"phase_seconds\": {", candidates_evaluated.load());
+    for (std::size_t i = 0; i < phase_seconds.size(); i++) {
+        std::fprintf(out, "%s\"%s\": %.6f", i == 0 ? "" : ", ", PHASE_NAMES[i], phase_seconds[i]);
+    }
+    std::fprintf(out, "}, \"stats\": {");
+    for (std::size_t i = 0; i < stats.size(); i++) {
+        std::fprintf(out, "%s\"%s\": %" PRIu64, i == 0 ? "" : ", ", STAT_NAMES[i], stats[i].load());
+    }
+    std::fprintf(out, "}");
+}
+
+void print_stats() {
+    flush_stats();
+    std::fprintf(stderr, "%-18s %14" PRIu64 "\n", "candidates", candidates_evaluated.load());
+    for (std::size_t i = 0; i < stats.size(); i++) {
+        std::fprintf(stderr, "%-18s %14" PRIu64 "\n", STAT_NAMES[i], stats[i].load());
+    }
+    for (std::size_t i = 0; i < phase_seconds.size(); i++) {
+        std::fprintf(stderr, "%-18s %13.3fs\n", PHASE_NAMES[i], phase_seconds[i]);
+    }
+}
+
+/* fixed workloads for --bench, so runs can be compared across commits */
+struct bench_workload_t {
+    const char *name;
+    std::int32_t digits, max_expr_size, max_int_constants;
+    std::vector<std::string> constants; /* default constant names, or "name = value [unit]" */
+    const char *target;
+};
+
+const std::vector<bench_workload_t> bench_workloads = {
+    {"base", 20, 2, 3, {"pi", "e"}, "2.71828"},
+    {"digits-10", 10, 2, 3, {"pi", "e"}, "2.71828"},
+    {"digits-30", 30, 2, 3, {"pi", "e"}, "2.71828"},
+    {"ints-12", 20, 2, 12, {"pi", "e"}, "2.71828"},
+    {"constants-6", 20, 2, 3, {"pi", "e", "euler", "ln2", "catalan", "phi"}, "1.2345"},
+    {"units", 20, 2, 3, {"pi", "c = 299792458 m/s", "l = 1.616255e-35 m", "t = 5.391247e-44 s"}, "3e8 m/s"},
+    {"size-3", 10, 3, 2, {"pi", "e"}, "3.1416"},
+};
+
+/* runs one workload in this process and prints it as one line of json */
+void run_bench_workload(const bench_workload_t &workload, std::int32_t thread_count) {
+    quiet = true;
+    digits_prec = workload.digits;
+    max_expr_size = workload.max_expr_size;
+    max_int_constants = workload.max_int_constants;
+    mpreal::set_default_prec(digits_to_prec(digits_prec));
+
+    std::vector<dimreal_t> targets;
+    {
+        phase_timer_t timer(phase_t::setup);
+        for (const std::string &text : workload.constants) {
+            auto pos = std::find_if(default_constants.begin(), default_constants.end(), [&](const default_cnst_t &constant) { return constant.name == text; });
+            if (pos != default_constants.end()) {
+                constants.push_back(cnst_t{dimreal_t{pos->compute()}, pos->name, true});
+                continue;
+            }
+            const std::size_t eq = text.find('=');
+            const std::string value = text.substr(eq + 2);
+            constants.push_back(cnst_t{dimreal_t{mpreal(value), phys::units::to_unit(value, phys::units::dimensionless())}, text.substr(0, eq - 1)});
+        }
+        targets.push_back(dimreal_t{mpreal(workload.target), phys::units::to_unit(workload.target, phys::units::dimensionless())});
+    }
+
+    search_start = std::chrono::steady_clock::now();
+    const std::vector<topk_t> results = search(targets, thread_count, false);
+
+    std::string rendered;
+    {
+        phase_timer_t timer(phase_t::output);
+        render_results(results.front(), rendered);
+    }
+
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    const double enumeration = phase_seconds[static_cast<std::size_t>(phase_t::enumeration)];
+
+    std::printf("{\"workload\": \"%s\", \"digits\": %i, \"max_expr_size\": %i, \"max_int_constants\": %i, \"constants\": %zu, \"threads\": %i, ",
+                workload.name, workload.digits, workload.max_expr_size, workload.max_int_constants, workload.constants.size(), thread_count);
+    std::printf("\"candidates_per_second\": %.1f, \"peak_rss_kb\": %ld, \"output_bytes\": %zu, ",
+                enumeration > 0 ? candidates_evaluated.load() / enumeration : 0.0, usage.ru_maxrss, rendered.size());
+    print_stats_json(stdout);
+    std::printf("}\n");
+
+    std::fprintf(stderr, "%-12s %10" PRIu64 " candidates %12.1f /s %8ld KiB peak, enumeration %.3fs\n",
+                 workload.name, candidates_evaluated.load(), enumeration > 0 ? candidates_evaluated.load() / enumeration : 0.0, usage.ru_maxrss, enumeration);
+}
+
+/* --bench, each workload gets its own process so peak rss and the counters start from nothing */
+int run_bench(std::int32_t thread_count) {
+    std::fflush(stdout);
+    int failed = 0;
+    for (const bench_workload_t &workload : bench_workloads) {
+        const pid_t pid = fork();
+        if (pid == 0) {
+            run_bench_workload(workload, thread_count);
+            std::fflush(stdout);
+            std::_Exit(0);
+        }
+        int status = 0;
+        if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            std::fprintf(stderr, "warning: bench workload \"%s\" failed\n", workload.name);
+            failed = 1;
+        }
+    }
+    return failed;
+}
+
+int main(int argc, char **argv) {
+    std::int32_t thread_count = 1;
+    const char *max_error_str = nullptr, *max_rel_error_str = nullptr, *collect_error_str = nullptr; /* parsed once the precision is known */
+    const char *digits_prec_arg = nullptr, *target_arg = nullptr, *max_expr_size_arg = nullptr, *max_int_constants_arg = nullptr;
+    const char *batch_filename = nullptr;
+    const char *socket_path = nullptr;
+    bool bench = false, print_stats_text = false;
+    std::string stats_json_filename; /* made absolute, since the search runs from inside save/ */
+
+    auto option_arg = [&](std::int32_t &i) -> const char* {
+        if (i + 1 >= argc) {
+            ERR_EXIT(err_t::missing_option_arg, "option \"%s\" expects an argument", argv[i])
+        }
+        return argv[++i];
+    };
+
+    if (argc >= 2 && !std::strcmp(argv[1], "merge")) {
+        std::vector<std::string> filenames;
+        for (std::int32_t i = 2; i < argc; i++) {
+            char *end = nullptr;
+            if (!std::strcmp(argv[i], "-k") || !std::strcmp(argv[i], "--top")) {
+                result_count = std::strtoull(option_arg(i), &end, 0);
+                if (result_count == 0 || *end) {
+                    ERR_EXIT(err_t::bad_limit, "bad result count, must be an integer > 0")
+                }
+            } else if (!std::strcmp(argv[i], "--complexity")) {
+                complexity_weight = std::strtod(option_arg(i), &end);
+                if (!(complexity_weight >= 0) || end == argv[i] || *end) {
+                    ERR_EXIT(err_t::bad_limit, "bad complexity weight, must be a number >= 0")
+                }
+            } else {
+                filenames.emplace_back(argv[i]);
+            }
+        }
+        if (filenames.empty()) {
+            std::cerr << "error: merge expects partial result files\n";
+            return 4;
+        }
+        return merge_partials(filenames);
+    }
+
+    for (std::int32_t i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "-v") || !std::strcmp(argv[i], "--version")) {
+            std::cout << "exactonator version " VERSION ", " YEAR " by .stole.\n";
+            return 0;
+        }
+
+        if (!std::strcmp(argv[i], "-h") || !std::strcmp(argv[i], "--help")) {
+            std::cout << "usage: " << argv[0] << R"( [flags]
+       )" << argv[0] << R"( merge [-k <count>] <partial files...>
+
+    -j <count> : runs <count> threads
+    -d, --digits <digits> : digits of precision
+    -t, --target <value> : value to search for, with an optional unit
+    -s, --max-size <size> : max expr size
+    -i, --max-int <n> : integer constants up to <n>
+    -b, --batch <file> : searches for every target in <file> in one pass, one "[name =] value [unit]" per line
+    -k, --top <count> : prints the best <count> results (default 30)
+    --complexity <digits> : ranks results by error in digits plus <digits> per unit of description length (a node, one
+                            more per constant, one per digit of a literal past the first) instead of by error alone,
+                            and stops enumerating sizes too long to rank, give merge the same weight (default 0)
+    --shard <i>/<n> : only searches the i-th of n parts, writing the results to a partial file in save/ for merge
+    --bench : runs the fixed benchmark workloads, printing one json object per workload
+    --serve <path> : answers "<digits> <max size> <max int> <value> [unit]" queries on a unix socket at <path>,
+                     keeping constants and enumerated candidates between queries (and runs, in save/)
+    --stream : prints each new best result as soon as it's found
+    -q, --quiet : no progress reports on stderr while searching
+    --stats : prints hot path counters and time per phase to stderr when done
+    --stats-json <file> : writes the same counters to <file> as json
+    --max-error <err> : stops once a result is within <err> of the target (not in batch mode)
+    --max-rel-error <err> : stops once a result is within <err> * |target| of the target (not in batch mode)
+    --engine <name> : enumerate (default) tries every expression up to the max size,
+                      pslq looks for integer relations a0 t + a1 c1 + ... + d = 0 and the same over logarithms,
+                      monomial matches products of powers of the constants and primes, up to twice the max size
+                      in total exponent, as two halves of up to the max size each,
+                      beam only extends the best --beam-width expressions of each size up to the max size,
+                      gp evolves expressions of up to 2 * max size + 1 nodes on one island per thread
+    --beam-width <n> : expressions kept per size for --engine beam (default 1000)
+    --population <n> : individuals per island for --engine gp (default 200)
+    --generations <n> : generations for --engine gp (default 200)
+    --migrate-every <n> : generations between migrations for --engine gp (default 10)
+    --size-penalty <digits> : score given up per node for --engine gp (default 0.25)
+    --gp-seed <n> : random seed for --engine gp, island i uses <n> + i (default 1)
+    --max-coeff <n> : largest relation coefficient for --engine pslq (default 1000)
+    --no-prepass : skips the continued fraction pass for p / q * constant and quadratic irrationals before enumerating
+    --functions <list> : also applies these to dimensionless subexpressions, comma separated from
+                         sqrt, exp, ln, sin, cos, tan, gamma, or all (default none)
+    --no-egraph : only merges results that simplify to the same expression, not ones equal by rearranging it
+    --prune-equivalent : doesn't expand an expression that simplifies to one already expanded from the same seed
+    --collect <err> : also writes every candidate within <err> of the target to a file in save/, sorted by error (not in batch mode)
+    --collect-memory <MiB> : memory for --collect before candidates are spilled to disk (default 256)
+    --max-candidates <count> : stops after evaluating <count> candidates
+    --time-budget <seconds> : stops after searching for <seconds>
+    --deepen : searches each size in turn up to the max size, printing the results so far after each one, so a
+               --time-budget stop still gives the best of every size that finished
+    -v, --version : displays texproj's version
+    -h, --help : displays this help
+)";
+            return 0;
+        }
+
+        if (!std::strcmp(argv[i], "-j")) {
+            thread_count = std::strtol(option_arg(i), nullptr, 0);
+            if (thread_count <= 0) {
+                ERR_EXIT(err_t::bad_thread_count, "bad thread count, must be an integer > 0")
+            }
+        } else if (!std::strcmp(argv[i], "-d") || !std::strcmp(argv[i], "--digits")) {
+            digits_prec_arg = option_arg(i);
+        } else if (!std::strcmp(argv[i], "-t") || !std::strcmp(argv[i], "--target")) {
+            target_arg = option_arg(i);
+        } else if (!std::strcmp(argv[i], "-s") || !std::strcmp(argv[i], "--max-size")) {
+            max_expr_size_arg = option_arg(i);
+        } else if (!std::strcmp(argv[i], "-i") || !std::strcmp(argv[i], "--max-int")) {
+            max_int_constants_arg = option_arg(i);
+        } else if (!std::strcmp(argv[i], "-b") || !std::strcmp(argv[i], "--batch")) {
+            batch_filename = option_arg(i);
+        } else if (!std::strcmp(argv[i], "-k") || !std::strcmp(argv[i], "--top")) {
+            result_count = std::strtoull(option_arg(i), nullptr, 0);
+            if (result_count == 0) {
+                ERR_EXIT(err_t::bad_limit, "bad result count, must be an integer > 0")
+            }
+        } else if (!std::strcmp(argv[i], "--complexity")) {
+            complexity_weight = std::strtod(option_arg(i), nullptr);
+            if (!(complexity_weight >= 0)) {
+                ERR_EXIT(err_t::bad_limit, "bad complexity weight, must be a number >= 0")
+            }
+        } else if (!std::strcmp(argv[i], "--shard")) {
+            if (std::sscanf(option_arg(i), "%u/%u", &shard_index, &shard_count) != 2 || shard_count == 0 || shard_index >= shard_count) {
+                ERR_EXIT(err_t::bad_shard, "bad shard, must be <i>/<n> with 0 <= i < n")
+            }
+        } else if (!std::strcmp(argv[i], "--bench")) {
+            bench = true;
+        } else if (!std::strcmp(argv[i], "--serve")) {
+            socket_path = option_arg(i);
+        } else if (!std::strcmp(argv[i], "--stream")) {
+            stream = std::make_unique<stream_t>();
+        } else if (!std::strcmp(argv[i], "-q") || !std::strcmp(argv[i], "--quiet")) {
+            quiet = true;
+        } else if (!std::strcmp(argv[i], "--stats")) {
+            print_stats_text = true;
+        } else if (!std::strcmp(argv[i], "--stats-json")) {
+            stats_json_filename = std::filesystem::absolute(option_arg(i)).string();
+        } else if (!std::strcmp(argv[i], "--max-error")) {
+            max_error_str = option_arg(i);
+        } else if (!std::strcmp(argv[i], "--max-rel-error")) {
+            max_rel_error_str = option_arg(i);
+        } else if (!std::strcmp(argv[i], "--engine")) {
+            const char *name = option_arg(i);
+            if (!std::strcmp(name, "enumerate")) {
+                engine = engine_t::enumerate;
+            } else if (!std::strcmp(name, "pslq")) {
+                engine = engine_t::pslq;
+            } else if (!std::strcmp(name, "monomial")) {
+                engine = engine_t::monomial;
+            } else if (!std::strcmp(name, "beam")) {
+                engine = engine_t::beam;
+            } else if (!std::strcmp(name, "gp")) {
+                engine = engine_t::gp;
+            } else {
+                ERR_EXIT(err_t::bad_engine, "unknown engine \"%s\", expected enumerate, pslq, monomial, beam or gp", name)
+            }
+        } else if (!std::strcmp(argv[i], "--beam-width")) {
+            beam_width = std::strtoul(option_arg(i), nullptr, 0);
+            if (beam_width == 0) {
+                ERR_EXIT(err_t::bad_limit, "bad beam width, must be an integer > 0")
+            }
+        } else if (!std::strcmp(argv[i], "--population")) {
+            population_size = std::strtoul(option_arg(i), nullptr, 0);
+            if (population_size < 2) {
+                ERR_EXIT(err_t::bad_limit, "bad population, must be an integer > 1")
+            }
+        } else if (!std::strcmp(argv[i], "--generations")) {
+            generations = std::strtoul(option_arg(i), nullptr, 0);
+            if (generations == 0) {
+                ERR_EXIT(err_t::bad_limit, "bad generation count, must be an integer > 0")
+            }
+        } else if (!std::strcmp(argv[i], "--migrate-every")) {
+            migrate_every = std::strtoul(option_arg(i), nullptr, 0);
+            if (migrate_every == 0) {
+                ERR_EXIT(err_t::bad_limit, "bad migration interval, must be an integer > 0")
+            }
+        } else if (!std::strcmp(argv[i], "--size-penalty")) {
+            size_penalty = std::strtod(option_arg(i), nullptr);
+        } else if (!std::strcmp(argv[i], "--gp-seed")) {
+            gp_seed = std::strtoull(option_arg(i), nullptr, 0);
+        } else if (!std::strcmp(argv[i], "--max-coeff")) {
+            max_coeff = std::strtoul(option_arg(i), nullptr, 0);
+            if (max_coeff < 2) {
+                ERR_EXIT(err_t::bad_limit, "bad max coefficient, must be an integer > 1")
+            }
+        } else if (!std::strcmp(argv[i], "--no-prepass")) {
+            prepass = false;
+        } else if (!std::strcmp(argv[i], "--deepen")) {
+            deepen = true;
+        } else if (!std::strcmp(argv[i], "--functions")) {
+            std::vector<std::string> names;
+            split(option_arg(i), ",", names);
+            functions.clear();
+            for (const std::string &name : names) {
+                if (name == "all") {
+                    for (std::size_t f = 0; f < static_cast<std::size_t>(func_t::count); f++) {
+                        functions.push_back(static_cast<func_t>(f));
+                    }
+                    continue;
+                }
+                auto it = std::find_if(std::begin(FUNC_NAMES), std::end(FUNC_NAMES), [&](const char *func) { return name == func; });
+                if (it == std::end(FUNC_NAMES)) {
+                    ERR_EXIT(err_t::bad_function, "unknown function \"%s\", expected sqrt, exp, ln, sin, cos, tan, gamma or all", name.c_str())
+                }
+                functions.push_back(static_cast<func_t>(it - std::begin(FUNC_NAMES)));
+            }
+        } else if (!std::strcmp(argv[i], "--no-egraph")) {
+            use_egraph = false;
+        } else if (!std::strcmp(argv[i], "--prune-equivalent")) {
+            prune_equivalent = true;
+        } else if (!std::strcmp(argv[i], "--collect")) {
+            collect_error_str = option_arg(i);
+        } else if (!std::strcmp(argv[i], "--collect-memory")) {
+            collect_memory = std::strtoull(option_arg(i), nullptr, 0) << 20;
+            if (collect_memory == 0) {
+                ERR_EXIT(err_t::bad_limit, "bad collect memory, must be an integer number of MiB > 0")
+            }
+        } else if (!std::strcmp(argv[i], "--max-candidates")) {
+            max_candidates = std::strtoull(option_arg(i), nullptr, 0);
+            if (max_candidates == 0) {
+                ERR_EXIT(err_t::bad_limit, "bad candidate limit, must be an integer > 0")
+            }
+        } else if (!std::strcmp(argv[i], "--time-budget")) {
+            time_budget = std::strtod(option_arg(i), nullptr);
+            if (!(time_budget > 0)) {
+                ERR_EXIT(err_t::bad_limit, "bad time budget, must be a number of seconds > 0")
+            }
+        } else {
+            std::cerr << "error: unexpected option \"" << argv[i] << "\"\n";
+            return 4;
+        }
+    }
+
+    if (thread_count > 1 && !mpfr_buildopt_tls_p()) {
+        ERR_EXIT(err_t::bad_thread_count, "mpfr was built without thread-local storage, can only run 1 thread")
+    }
+
+    if (bench) {
+        return run_bench(thread_count);
+    }
+
+    if (!std::filesystem::exists(SAVE_AST_DIR)) {
+        if (!std::filesystem::create_directory(SAVE_AST_DIR)) {
+            ERR_EXIT(err_t::create_save_dir, "AST save directory \"%s\" does not exist, failed to create", SAVE_AST_DIR)
+        }
+    }
+
+    if (socket_path) {
+        if (time_budget > 0 || max_candidates != 0) {
+            ERR_EXIT(err_t::bad_limit, "--time-budget and --max-candidates can't be used with --serve, its tables have to be complete")
+        }
+        server_t{thread_count}.serve(socket_path);
+        return 0;
+    }
+
+    /* anything not given on the command line is asked for */
+    auto ask = [](const char *prompt, const char *given) -> std::string {
+        if (given) { return given; }
+        std::cout << prompt;
+        std::string line;
+        std::getline(std::cin, line);
+        return line;
+    };
+
+    digits_prec = std::stoi(ask("digits: ", digits_prec_arg));
+    mpreal::set_default_prec(digits_to_prec(digits_prec));
 
-        constants.push_back(tcnst);
+    /* an error bound has to read fully as a number, and be finite and >= 0 */
+    auto error_limit = [](const char *str, const char *what) -> mpreal {
+        mpreal limit;
+        if (mpfr_set_str(limit.mpfr_ptr(), str, 10, mpreal::get_default_rnd()) != 0 || !isfinite(limit) || limit < 0) {
+            ERR_EXIT(err_t::bad_limit, "bad %s \"%s\", must be a finite number >= 0", what, str)
+        }
+        return limit;
+    };
+
+    if (max_error_str) {
+        max_error = error_limit(max_error_str, "max error");
+    }
+    if (max_rel_error_str) {
+        max_rel_error = error_limit(max_rel_error_str, "max relative error");
+    }
+    if (collect_error_str) {
+        collect_error = error_limit(collect_error_str, "collect error");
+    }
+
+    std::vector<std::pair<std::string, dimreal_t>> batch_targets;
+    if (batch_filename) {
+        batch_targets = read_batch(batch_filename);
+    } else {
+        target = std::make_unique<dimreal_t>(dimreal_t::from_str(ask("target: ", target_arg)));
+    }
+
+    max_expr_size = std::stoi(ask("max expr size: ", max_expr_size_arg));
+    max_int_constants = std::stoi(ask("integer constants up to: ", max_int_constants_arg));
+
+    {
+        phase_timer_t timer(phase_t::setup);
+        constants = read_constants();
     }
 
 
@@ -692,34 +4443,217 @@ int main(int argc, char **argv) {
     savefile.close();
     /* ---- */
 
-    for (const cnst_t &constant : constants) {
-        test_expr(std::make_shared<cnstexpr_t>(constant), 1);
-    }
+    search_start = std::chrono::steady_clock::now();
 
-    for (mpreal i = 1; i <= max_int_constants; i++) {
-        test_expr(std::make_shared<litexpr_t>(dimreal_t{i, target->unit}), 1);
+    std::string collect_filename = savefilename.str() + ".collected";
+    if (shard_count > 1) {
+        collect_filename += ".shard-" + std::to_string(shard_index) + "-of-" + std::to_string(shard_count);
+    }
+    if (collect_error && !batch_filename) {
+        collector = std::make_unique<collector_t>(collect_filename, target->unit, thread_count);
     }
 
-    decltype(all) selected;
+    /* the rationals and quadratic irrationals are in hand before the enumeration starts, so they're reported right away
+     * (through --stream when it's on) and merged into its results
+     */
+    std::vector<topk_t> prepass_results;
+    if (prepass && engine == engine_t::enumerate) {
+        {
+            phase_timer_t timer(phase_t::setup);
+            if (!batch_filename) {
+                prepass_results.push_back(continued_fraction_search(*target));
+            }
+            for (const auto &[name, value] : batch_targets) {
+                prepass_results.push_back(continued_fraction_search(value));
+            }
+        }
+        phase_timer_t timer(phase_t::output);
+        if (stream && !batch_filename) {
+            for (const result_t &item : prepass_results.front().items) {
+                stream->offer(item.err, item.expr, 0);
+            }
+        } else if (std::any_of(prepass_results.begin(), prepass_results.end(), [](const topk_t &found) { return !found.items.empty(); })) {
+            std::cout << "-- continued fractions\n";
+            for (std::size_t i = 0; i < prepass_results.size(); i++) {
+                if (prepass_results[i].items.empty()) { continue; }
+                if (batch_filename) {
+                    std::cout << "== " << batch_targets[i].first << " = " << batch_targets[i].second.to_str() << '\n';
+                }
+                print_results(prepass_results[i]);
+            }
+            std::cout.flush();
+        }
+    }
 
-    /* remove expressions with the same error, picking the one with the smallest expression length */
-    for (const std::pair<mpreal, sptrexpr_t> &a : all) {
-        auto pos = std::find_if(selected.begin(), selected.end(), [&](const std::pair<mpreal, sptrexpr_t> &b) { return a.first == b.first; });
-        if (pos != selected.end()) {
-            if (pos->second->size() > a.second->size()) {
-                *pos = a;
+    /* the results up to one size for --deepen, names[i] for results[i] and prepass_results[where[i]] */
+    auto publish = [&](std::int32_t size, const std::vector<std::string> &names, const std::vector<std::size_t> &where, const std::vector<topk_t> &level) {
+        phase_timer_t timer(phase_t::output);
+        std::cout << "-- up to size " << size << '\n';
+        for (std::size_t i = 0; i < level.size(); i++) {
+            if (batch_filename) {
+                std::cout << "== " << names[i] << '\n';
             }
+            topk_t merged = level[i];
+            if (!prepass_results.empty()) {
+                merged.merge(prepass_results[where[i]]);
+            }
+            print_results(merged);
+        }
+        std::cout.flush();
+    };
+
+    std::vector<topk_t> results;
+    if (engine == engine_t::pslq) {
+        if (!batch_filename) {
+            batch_targets.emplace_back("target", *target);
+        }
+        phase_timer_t timer(phase_t::enumeration);
+        for (const auto &[name, value] : batch_targets) {
+            results.push_back(relation_search(value));
+        }
+    } else if (engine == engine_t::monomial) {
+        if (!batch_filename) {
+            batch_targets.emplace_back("target", *target);
+        }
+        std::optional<monomial_index_t> index;
+        {
+            phase_timer_t timer(phase_t::setup);
+            index.emplace(max_expr_size);
+        }
+        phase_timer_t timer(phase_t::enumeration);
+        for (const auto &[name, value] : batch_targets) {
+            results.push_back(index->search(value));
+        }
+    } else if (engine == engine_t::beam) {
+        if (!batch_filename) {
+            batch_targets.emplace_back("target", *target);
+        }
+        phase_timer_t timer(phase_t::enumeration);
+        if (stream) {
+            stream->start();
+        }
+        for (const auto &[name, value] : batch_targets) {
+            results.push_back(beam_search(value, thread_count, !batch_filename));
+        }
+        if (stream) {
+            stream->finish();
+        }
+    } else if (engine == engine_t::gp) {
+        if (!batch_filename) {
+            batch_targets.emplace_back("target", *target);
+        }
+        phase_timer_t timer(phase_t::enumeration);
+        if (stream) {
+            stream->start();
+        }
+        for (const auto &[name, value] : batch_targets) {
+            results.push_back(gp_search(value, thread_count, !batch_filename));
+        }
+        if (stream) {
+            stream->finish();
+        }
+    } else if (!batch_filename) {
+        if (stream) {
+            stream->start();
+        }
+        if (deepen) {
+            results = deepening_search({*target}, thread_count, true, [&](std::int32_t size, const std::vector<topk_t> &level) {
+                publish(size, {"target"}, {0}, level);
+            });
         } else {
-            selected.emplace_back(a.first, a.second);
+            results = search({*target}, thread_count, true);
+        }
+        if (stream) {
+            stream->finish();
+        }
+        batch_targets.emplace_back("target", *target);
+    } else {
+        /* literals take their units from the target, so there's one pass per distinct dimension */
+        std::vector<std::optional<topk_t>> batch_results(batch_targets.size());
+        for (std::size_t i = 0; i < batch_targets.size(); i++) {
+            if (batch_results[i]) { continue; }
+            std::vector<std::size_t> group;
+            std::vector<dimreal_t> group_targets;
+            for (std::size_t j = i; j < batch_targets.size(); j++) {
+                if (!batch_results[j] && batch_targets[j].second.unit.same_dimension(batch_targets[i].second.unit)) {
+                    group.push_back(j);
+                    group_targets.push_back(batch_targets[j].second);
+                    batch_results[j].emplace();
+                }
+            }
+            std::vector<topk_t> group_results;
+            if (deepen) {
+                std::vector<std::string> names;
+                for (std::size_t j : group) {
+                    names.push_back(batch_targets[j].first + " = " + batch_targets[j].second.to_str());
+                }
+                group_results = deepening_search(group_targets, thread_count, false, [&](std::int32_t size, const std::vector<topk_t> &level) {
+                    publish(size, names, group, level);
+                });
+            } else {
+                group_results = search(group_targets, thread_count, false);
+            }
+            for (std::size_t j = 0; j < group.size(); j++) {
+                batch_results[group[j]] = std::move(group_results[j]);
+            }
+        }
+        for (std::optional<topk_t> &batch_result : batch_results) {
+            results.push_back(std::move(*batch_result));
         }
     }
 
-    std::sort(selected.begin(), selected.end(), [](const std::pair<mpreal, sptrexpr_t> &a, const std::pair<mpreal, sptrexpr_t> &b) {
-        return a.first < b.first;
-    });
+    for (std::size_t i = 0; i < prepass_results.size(); i++) {
+        results[i].merge(prepass_results[i]);
+    }
+
+    if (stop_search) {
+        std::cerr << "stopped early: " << stop_reason << '\n';
+    }
+
+    if (collector) {
+        const std::uint64_t written = collector->merge(collect_filename);
+        std::cerr << "wrote " << written << " candidates to " << SAVE_AST_DIR << '/' << collect_filename << '\n';
+    }
+
+    if (shard_count > 1) {
+        const std::string config = partial_config(seed_str, batch_targets);
+        std::stringstream config_hash;
+        config_hash << std::hex << std::hash<std::string>{}(config);
+        const std::string partial_filename = config_hash.str() + ".shard-" + std::to_string(shard_index) + "-of-" + std::to_string(shard_count);
+        write_partial(partial_filename, config, batch_targets, results);
+        std::cerr << "wrote partial results to " << SAVE_AST_DIR << '/' << partial_filename << '\n';
+    } else {
+        /* the last results for each configuration are kept next to its config line */
+        results_file_t file{mpreal::get_default_prec(), digits_prec, seed_str, 0, 1, constants, {}};
+        for (std::size_t i = 0; i < results.size(); i++) {
+            file.add(batch_targets[i].first, batch_targets[i].second, results[i]);
+        }
+        file.write(savefilename.str() + ".results");
+    }
+
+    {
+        phase_timer_t timer(phase_t::output);
+        for (std::size_t i = 0; i < results.size(); i++) {
+            if (batch_filename) {
+                std::cout << "== " << batch_targets[i].first << " = " << batch_targets[i].second.to_str() << '\n';
+            }
+            print_results(results[i]);
+        }
+        std::cout.flush();
+    }
 
-    for (std::uint32_t i = 0; i < 30 && i < selected.size(); i++) {
-        std::cout << selected[i].second->disp() << " | err: " << selected[i].first.toString(digits_prec) << '\n';
+    if (print_stats_text) {
+        print_stats();
+    }
+    if (!stats_json_filename.empty()) {
+        std::FILE *file = std::fopen(stats_json_filename.c_str(), "w");
+        if (!file) {
+            ERR_EXIT(err_t::write_stats, "failed to write stats to \"%s\"", stats_json_filename.c_str())
+        }
+        std::fprintf(file, "{");
+        print_stats_json(file);
+        std::fprintf(file, "}\n");
+        std::fclose(file);
     }
 
     return 0;